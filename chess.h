@@ -5,12 +5,99 @@
 
 #define BOARD_SIZE 8
 
+#define MAX_LEGAL_MOVES 256 // upper bound on the legal moves of a single position
+
+#define PN_INFINITY 0x3FFFFFFF // proof / disproof number used for solved nodes
+
+#define SOLVER_TABLE_SIZE (1 << 20) // transposition table entries for every solver thread
+
+#define ANALYSIS_CACHE_MAGIC 0x43534843 // "CHSC", the first bytes of an analysis cache file
+
+#define ANALYSIS_CACHE_VERSION 1 // bump when the layout of AnalysisEntry changes
+
+#define ANALYSIS_CACHE_BYTES (64ULL << 20) // default size limit of the entries of the analysis cache file, the header comes on top
+
+#define ANALYSIS_BUCKET_SIZE 4 // entries that share one cache line, the replacement picks one of them
+
+#define BROADCAST_MAGIC 0x43534842 // "CHSB", the first bytes of a broadcast file
+
+#define BROADCAST_VERSION 1 // bump when the layout of BroadcastFrame changes
+
+#define BROADCAST_SLOTS 4096 // frames a broadcast file keeps, a spectator that falls further behind skips ahead
+
+#define JOURNAL_MAGIC 0x43534A4C // "CHSJ" in the header record of a game journal
+
+#define JOURNAL_VERSION 1 // bump when the layout of a journal record changes
+
+#define JOURNAL_BATCH_RECORDS 512 // a batch of this many records is written and synced at once
+#define JOURNAL_FLUSH_MS 10       // a smaller batch waits at most this long for its fsync
+
+#define JOURNAL_HEADER 0 // the first record of the file, gameId holds JOURNAL_MAGIC and ply the version
+#define JOURNAL_START 1  // a new game, seconds holds the clock of both players
+#define JOURNAL_MOVE 2   // a move accepted by PerformMove, seconds holds the time the player took
+#define JOURNAL_END 3    // the game is over, it is not resumed
+
+#define JOURNAL_RECORD_SIZE 16
+
+#define REPLAY_KEYFRAME_INTERVAL 8 // a replay stores a snapshot every this many plies
+
+#define FEN_BATCH_LINES 16384 // lines the bulk FEN tool reads before the threads work on them
+
+#define FEN_MAX_CLOCK 99999 // the largest halfmove clock and fullmove number a FEN string may have
+
+#define TOURNAMENT_MAX_PLIES 300 // a tournament game that reaches this many plies is a draw
+
+#define SPRT_ELO0 0.0   // the SPRT null hypothesis, engine A is not stronger than this
+#define SPRT_ELO1 10.0  // the SPRT alternative hypothesis, engine A is at least this much stronger
+#define SPRT_ALPHA 0.05 // chance to accept the alternative when the null hypothesis is true
+#define SPRT_BETA 0.05  // chance to accept the null hypothesis when the alternative is true
+
+#define MAX_WORKERS 256 // how many workers can connect to one coordinator
+
+#define DISTRIBUTED_PORT 7878 // the TCP port a coordinator listens on when none is given
+
+#define MESSAGE_JOB 1     // coordinator to worker: search one root move
+#define MESSAGE_RESULT 2  // worker to coordinator: the score of a job, also asks for the next one
+#define MESSAGE_REQUEST 3 // worker to coordinator: ready for a job
+#define MESSAGE_QUIT 4    // coordinator to worker: the analysis is over
+
+#define JOB_MESSAGE_SIZE 46   // type, job id, alpha, beta, depth, move, PositionSnapshot
+#define RESULT_MESSAGE_SIZE 15 // type, job id, score, nodes
+
+#define JOB_PENDING 0
+#define JOB_RUNNING 1
+#define JOB_DONE 2
+
+#define TRAINING_RANDOM_PLIES 8 // random moves played from the start position before a training game
+
+#define TRAINING_BUFFER_POSITIONS 32768 // packed positions a generator thread collects before writing them
+
+#define EVAL_MATERIAL 0       // EvalFeatures::terms, pawns to queens of white minus black
+#define EVAL_MOBILITY 5       // reachable squares of knights, bishops, rooks and queens, white minus black
+#define EVAL_KING_SHIELD 9    // own pawns right in front of the king, white minus black
+#define EVAL_KING_ATTACK 10   // squares next to the king the opponent attacks, white minus black
+#define EVAL_TERMS 11
+#define EVAL_WEIGHTS (EVAL_TERMS + 6 * 64) // the terms, then the piece-square tables of P N B R Q K
+#define EVAL_BLACK_PIECE 0x8000            // set in EvalFeatures::pieceSquares for a black piece
+
+#define TUNER_BLOCK 256          // positions the tuner scores at once, a multiple of the vector width
+#define TUNER_LEARNING_RATE 1.0  // the Adam step, in centipawns
+#define TUNER_SCALE 0.00575646   // ln(10) / 400, turns a score into a winning chance like Elo does
+
+#define MATE_SCORE 30000 // score of a mate in 0, a mate in n is MATE_SCORE - n
+
+#define POSITION_NORMAL 0
+#define POSITION_CHECK 1
+#define POSITION_CHECKMATE 2
+#define POSITION_STALEMATE 3
+
 typedef struct // struct for the Piece of every soldier
 {
     char type;
     char color;
     int x,y;
     bool hasMoved;
+    int code; // dense piece code (see PieceCode), it indexes the move function tables
 } Piece;
 
 typedef struct // strcut for the player details
@@ -31,6 +118,8 @@ typedef struct // struct for the chess board
     Piece* board[8][8];
 } Board;
 
+typedef bool (*MoveFunction)(Board *board, int startX, int startY, int endX, int endY, Player *player); // the movement rules of one piece code
+
 typedef struct // struct for every move
 {
     int startX, startY; // Starting coordinates of the piece
@@ -45,6 +134,34 @@ typedef struct // struct for every move
     struct Move *next;
 } Move;
 
+typedef struct // struct for one record of the game journal, JOURNAL_RECORD_SIZE bytes in the file
+{
+    uint8_t type;     // JOURNAL_HEADER, JOURNAL_START, JOURNAL_MOVE or JOURNAL_END
+    uint16_t ply;
+    uint32_t gameId;
+    uint16_t move;    // see PackMove
+    uint16_t seconds;
+} JournalRecord;
+
+typedef struct // struct for a game journal opened by this process
+{
+    FILE *file;
+    JournalRecord *records;   // the records the file had when it was opened, used for recovery
+    int recordCount;
+    uint32_t nextGameId;      // one more than the largest game id in the file
+    uint8_t *buffers[2];      // records are appended to one buffer while the other one is written
+    size_t capacities[2];
+    size_t used;              // bytes in the buffer that takes the appends
+    int active;               // the buffer that takes the appends
+    bool isStopping;
+    bool failed;              // a write or an allocation failed, records after it may be lost
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    unsigned long long syncs; // batches written, every one is a single fsync
+    unsigned long long appended;
+} GameJournal;
+
 typedef struct
 {
     Board* board;
@@ -52,12 +169,211 @@ typedef struct
     int currentPlayer; // 0 for Player 1, 1 for Player 2
     int moveCount;
     Move moveHistory[MAX_MOVES];
+    GameJournal *journal; // every move PerformMove accepts is appended to it, NULL when not used
+    uint32_t id;          // the game id in the journal
 } Game;
 
+typedef struct // struct for the settings of the computer player
+{
+    char name[64];
+    int depth;          // how many plies the search looks ahead
+    int pieceValues[6]; // P N B R Q K
+    int timeSeconds;    // the clock of every game, like Player::timeLeft
+} EngineConfig;
+
+typedef struct // struct for one engine against engine game
+{
+    const EngineConfig *engines[2]; // 0 plays white, 1 plays black
+    const char *openingFen;
+    uint64_t seed;                  // picks between moves of the same score
+    uint32_t id;                    // the game number spectators see in the broadcast
+    int result;                     // 1 white wins, 0 draw, -1 black wins
+    int plies;
+    void (*recordPosition)(void *context, Board *board, char sideToMove, const Move *move, int ply); // called before every move, may be NULL
+    void *context;
+} EngineGame;
+
+typedef struct // struct for a position of the training data, 32 bytes in the file
+{
+    uint64_t occupancy; // bit n is set when square n (x * 8 + y) has a piece
+    uint8_t pieces[16]; // the PieceCode of every occupied square in square order, two per byte
+    uint8_t flags;      // bit 0: black to move, bits 1-4: castling rights
+    int8_t result;      // 1 white won the game, 0 draw, -1 black won
+    uint16_t move;      // from square | to square << 6 | promotion piece code << 12
+    int16_t score;      // static evaluation for the side to move
+    uint16_t ply;       // how many plies the game had when the position came up
+} PackedPosition;
+
+typedef struct // struct for what the evaluation looks at, the score is linear in it
+{
+    int16_t terms[EVAL_TERMS];
+    uint16_t pieceSquares[32]; // piece type * 64 + square seen from its own side, EVAL_BLACK_PIECE for black
+    int pieceCount;
+} EvalFeatures;
+
+typedef struct // struct for the positions of the tuner, one array for every feature
+{
+    int count;             // positions, the arrays are padded to a multiple of TUNER_BLOCK
+    float *terms[EVAL_TERMS];
+    uint16_t *pieceSquares; // 32 for every position
+    uint8_t *pieceCounts;
+    float *results;        // 1 white won, 0.5 draw, 0 black won
+} TunerData;
+
+typedef struct // struct for one root move of a distributed analysis
+{
+    Move move;
+    int state;    // JOB_PENDING, JOB_RUNNING or JOB_DONE
+    int assigned; // how many workers are searching it, more than one after a steal
+    int score;
+} DistributedJob;
+
+typedef struct // struct for a worker connected to the coordinator
+{
+    int socket;
+    bool isIdle;    // waiting for a job
+    int currentJob; // -1 when it has none
+    int jobsDone;
+} DistributedWorker;
+
+typedef struct // struct for the fields of a FEN string that are not on the board
+{
+    char sideToMove;
+    int castling;           // the castling rights the FEN asks for, in the bits of CastlingRights
+    int enPassantX;         // the en passant target square, -1 when there is none
+    int enPassantY;
+    int halfmoveClock;
+    int fullmoveNumber;
+} FenState;
+
+typedef struct // struct for one line of the bulk FEN tool
+{
+    char fen[128];
+    char output[160];       // the line that is printed for it
+    bool isTooLong;         // the line did not fit in fen, it is reported as invalid
+    const char *error;      // why the position is not legal, NULL when it is
+    int legalMoveCount;
+    int status;
+} FenLine;
+
+typedef struct // struct for a compact copy of a position, 4 bits for every square
+{
+    uint8_t squares[32]; // two squares per byte, see PieceCode for the values
+    uint8_t flags;       // bit 0: black to move, bits 1-4: castling rights (white short, white long, black short, black long)
+} PositionSnapshot;
+
+typedef struct // struct for a loaded game that can be shown at any ply
+{
+    Move moves[MAX_MOVES];
+    int moveCount;
+    PositionSnapshot keyframes[MAX_MOVES / REPLAY_KEYFRAME_INTERVAL + 1]; // keyframes[k] is the position at ply k * REPLAY_KEYFRAME_INTERVAL
+    Board board;      // the position at the current ply
+    char sideToMove;
+    int ply;          // how many moves of the game are played on the board
+} GameReplay;
+
+typedef struct // struct for what we know about a position, this is what the analysis cache keeps
+{
+    int legalMoveCount;
+    int status;        // POSITION_NORMAL, POSITION_CHECK, POSITION_CHECKMATE or POSITION_STALEMATE
+    bool hasBestMove;
+    int bestStartX, bestStartY, bestEndX, bestEndY;
+    int score;         // from the side to move, MATE_SCORE - n for a mate in n
+    int depth;         // how many moves deep the score was searched, 0 for no search
+} PositionInfo;
+
+typedef struct // struct for the header at the start of the analysis cache file
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t bucketCount; // always a power of two
+    uint32_t generation;  // increased by every process that opens the file, used for aging
+    uint32_t reserved[11]; // pads the header to one cache line
+} AnalysisHeader;
+
+typedef struct // struct for one slot of the analysis cache
+{
+    uint64_t check; // key ^ data, a torn write from two processes fails this check
+    uint64_t data;  // the packed PositionInfo and the generation it was written in
+} AnalysisEntry;
+
+typedef struct // struct for an analysis cache opened by this process
+{
+    AnalysisHeader *header;
+    AnalysisEntry *entries;
+    size_t mappedSize;
+    uint8_t generation; // the generation this process writes
+} AnalysisCache;
+
+typedef struct // struct for the header at the start of a broadcast file
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t slotCount;    // always a power of two
+    uint64_t head;         // frames published so far, frame n is in slot n % slotCount
+    uint32_t reserved[10]; // pads the header to one cache line
+} BroadcastHeader;
+
+typedef struct // struct for one published position, one cache line in the broadcast file
+{
+    uint64_t sequence;         // 2 * n + 1 while frame n is written, 2 * n + 2 when it is complete
+    PositionSnapshot position;
+    uint8_t status;            // POSITION_NORMAL, POSITION_CHECK, POSITION_CHECKMATE or POSITION_STALEMATE
+    uint16_t lastMove;         // see PackMove, 0 before the first move
+    uint16_t ply;
+    uint32_t gameId;
+    int32_t timeLeft[2];       // seconds, white and black
+    uint8_t reserved[4];
+} BroadcastFrame;
+
+typedef struct // struct for a broadcast file mapped by this process
+{
+    BroadcastHeader *header;
+    BroadcastFrame *frames;
+    size_t mappedSize;
+} LiveBroadcast;
+
+typedef struct // struct that hold what is needed to take back a move made while searching
+{
+    Piece *captured;    // The piece that was on the destination square, if any
+    char originalType;  // The type of the moving piece before a promotion
+    bool pieceHadMoved; // The hasMoved flag of the moving piece before the move
+    bool rookHadMoved;  // The hasMoved flag of the rook on a castling move
+} MoveUndo;
+
+typedef struct // struct for a transposition table entry of the proof-number search
+{
+    uint64_t key;
+    uint32_t pn; // proof number, 0 when a forced mate is proven
+    uint32_t dn; // disproof number, 0 when the mate is refuted
+} ProofEntry;
+
+typedef struct // struct for the state of one mate solver (one per thread)
+{
+    ProofEntry *table;
+    unsigned long long nodes; // how many nodes the search has expanded
+    char attacker;            // the color that is trying to give mate
+} MateSolver;
+
+typedef struct // struct for every puzzle of a batch and its result
+{
+    char fen[128];
+    int mateIn;          // the puzzle asks for a mate in this many moves
+    int mateLength;      // the shortest mate found, 0 if there is none
+    bool isValid;        // false when the FEN could not be loaded
+    bool isSearched;     // false when no thread had the memory for a table to search it
+    unsigned long long nodes;
+    char solution[512];  // the solution line (e.g., "H1-H8 G8-H7 ...")
+} Puzzle;
+
 
 
 bool isGameOver = false; // a variable that hold if the game is over or not
 
+AnalysisCache *analysisCache = NULL; // the analysis cache shared with other processes, NULL when not used
+
+LiveBroadcast *liveBroadcast = NULL; // where games are published for spectators, NULL when not used
+
 
 //##########################-----INITIALIZATION FUNCTIONS---------############################
 
@@ -120,6 +436,14 @@ bool MoveKnight(Board *board, int startX, int startY, int endX, int endY, Player
 // The function should validate normal moves, captures, en passant, and promotion.
 bool MovePawn(Board *board, int startX, int startY, int endX, int endY, Player *player);
 
+// The pawn rules with the direction fixed at compile time, MovePawn and the move tables use them
+bool MovePawnWhite(Board *board, int startX, int startY, int endX, int endY, Player *player);
+
+bool MovePawnBlack(Board *board, int startX, int startY, int endX, int endY, Player *player);
+
+// Function for the empty codes of the move tables, it never allows a move
+bool MoveNone(Board *board, int startX, int startY, int endX, int endY, Player *player);
+
 
 //##########################-----END OF MOVEMENT AND RULES FUNCTIONS---------############################
 
@@ -145,7 +469,15 @@ void DisplayMoveHistory(Game *game, int n); // function to display the last n mo
 
 void saveGameHistory(Game *game); //function to save all the moves that was on the game
 
-void uploadGame(FILE *gamefile, char filename); //function that you could upload a game you had and then see it later
+bool uploadGame(const char *fileName, GameReplay *replay); //function that you could upload a game you had and then see it later
+
+bool SeekReplay(GameReplay *replay, int ply); //Show the game after ply moves, from the closest keyframe
+
+void StepReplay(GameReplay *replay, int plies); //Go forward (or back when negative) by some plies
+
+void FreeReplay(GameReplay *replay); //Free the pieces of the replay board
+
+int RunReplay(const char *fileName); //Let the user scrub through a saved game
 
 //##########################-----END OF GAME FLOW FUNCTIONS---------############################
 
@@ -157,8 +489,217 @@ const char* GetPieceSymbol(Piece *piece); //Return a character symbol for the pi
 
 bool IsMoveWithinBounds(int startX, int startY,int endX,int endY); //Check if the given coordinates are within the board limits.
 
-void ConvertAlgebraicToIndices(const char* position, int* x, int* y); // Function to convert algebraic notation (e.g., "E2") to board indices (e.g., (6, 4))
+void ConvertAlgebraicToIndices(const char* position, int* x, int* y); // Function to convert algebraic notation (e.g., "E2") to board indices (e.g., (1, 4))
+
+void ConvertIndicesToAlgebraic(int x, int y, char* position); // Function to convert board indices (e.g., (1, 4)) to algebraic notation (e.g., "E2")
+
+int GetCoreCount(void); // Return how many processors the machine has
 
 //##########################-----END OF UTILITY FUNCTIONS---------############################
 
+
+
+//##########################-----POSITION FUNCTIONS---------############################
+
+Piece* CreatePiece(int x, int y, char type, char color); //Allocate a piece and set its fields
+
+void ClearBoard(Board *board); //Set every square of the board to empty
+
+Piece* CreatePieceFromCode(int x, int y, int code); //Allocate a piece from its PieceCode, with hasMoved set from its square
+
+bool ParseFEN(Board *board, const char *fen, FenState *state); //Set up the board and state from a FEN string, the board must be empty
+
+bool LoadFEN(Board *board, const char *fen, char *sideToMove); //Set up the board from a FEN string, the board must be empty
+
+bool WriteFEN(Board *board, const FenState *state, char *out, size_t size); //Write the position as a FEN string, false when it needs more than size bytes
+
+const char* ValidatePosition(Board *board, const FenState *state); //Return why the position is not legal, NULL when it is
+
+int CountEnPassantMoves(Board *board, const FenState *state); //Count the legal en passant captures of the side to move
+
+char OpponentColor(char color); //Return the color of the other side
+
+bool IsSquareAttacked(Board *board, int x, int y, char attackerColor); //Check if any piece of attackerColor attacks the square
+
+bool IsKingInCheck(Board *board, char color); //Check if the king of the given color is attacked
+
+bool CanCastle(Board *board, Piece *king, int endY); //Check all castling conditions for the king moving to column endY
+
+bool IsPseudoLegalMove(Board *board, Piece *piece, int endX, int endY); //Check the movement rules without looking at the own king
+
+int GenerateLegalMoves(Board *board, char color, Move *moves); //Fill moves with every legal move of color and return how many there are
+
+void MakeMove(Board *board, const Move *move, MoveUndo *undo); //Play a move on the board without printing or storing it
+
+void UnmakeMove(Board *board, const Move *move, const MoveUndo *undo); //Take back a move that was played with MakeMove
+
+uint64_t HashBoard(Board *board, char sideToMove); //Return the zobrist key of the position
+
+void MoveToString(const Move *move, char *out); //Write the move in the "E2-E4" format
+
+int PieceCode(Piece *piece); //Return 0 for an empty square, 1-6 for white P N B R Q K and 9-14 for black
+
+int PieceCodeFromType(char type, char color); //Return the piece code of a type letter (either case) and a color
+
+void TakeSnapshot(Board *board, char sideToMove, PositionSnapshot *snapshot); //Pack the position into a snapshot
+
+void RestoreSnapshot(const PositionSnapshot *snapshot, Board *board, char *sideToMove); //Set up the board from a snapshot, the board must be empty
+
+//##########################-----END OF POSITION FUNCTIONS---------############################
+
+
+
+//##########################-----FEN TOOL FUNCTIONS---------############################
+
+void AnalyseFenLine(FenLine *line); //Validate one FEN line, count its legal moves and fill its output
+
+int RunFenStats(const char *fileName, int threadCount); //Check every FEN line of a file (or "-" for stdin) and print the results in order
+
+//##########################-----END OF FEN TOOL FUNCTIONS---------############################
+
+
+
+//##########################-----ENGINE FUNCTIONS---------############################
+
+void SetDefaultEngineConfig(EngineConfig *config); //Depth 2, the usual piece values and 60 seconds
+
+bool ParseEngineConfig(const char *spec, EngineConfig *config); //Read settings like "depth=3,queen=950,time=30"
+
+void InitEvaluation(void); //Find the parts of eval_tables.h that have weights, call it once at the start
+
+int EvaluatePosition(Board *board, char sideToMove, const EngineConfig *config); //Score the position for the side to move
+
+bool ChooseMove(Board *board, char sideToMove, const EngineConfig *config, uint64_t *seed, Move *best); //Search for the best move, false when there is no legal move
+
+void PlayEngineGame(EngineGame *game); //Play a game between two engines from the opening and fill its result
+
+//##########################-----END OF ENGINE FUNCTIONS---------############################
+
+
+
+//##########################-----TOURNAMENT FUNCTIONS---------############################
+
+int RunTournament(const char *specA, const char *specB, int gameCount, int threadCount); //Play engine A against engine B until SPRT decides or the games run out
+
+//##########################-----END OF TOURNAMENT FUNCTIONS---------############################
+
+
+
+//##########################-----TRAINING DATA FUNCTIONS---------############################
+
+uint16_t PackMove(const Move *move); //Pack a move in 16 bits: from square | to square << 6 | promotion piece code << 12
+
+void PackPosition(Board *board, char sideToMove, const Move *move, PackedPosition *packed); //Pack a position and the move played in it, the result is set later
+
+void WritePackedPosition(const PackedPosition *packed, uint8_t *out); //Write the 32 bytes of a position in little endian order
+
+void ReadPackedPosition(const uint8_t *in, PackedPosition *packed); //Read the 32 bytes of a position
+
+bool UnpackPosition(const PackedPosition *packed, Board *board, char *sideToMove); //Set up the board from a packed position, false for a damaged record
+
+int RunTrainingGenerator(const char *fileName, int gameCount, int threadCount, const char *engineSpec); //Play games on several threads and write every position ("file.gz" is compressed)
+
+int RunTrainingDump(const char *fileName, int count); //Print the first positions of a training file as FEN, move and result
+
+//##########################-----END OF TRAINING DATA FUNCTIONS---------############################
+
+
+
+//##########################-----TUNER FUNCTIONS---------############################
+
+void ExtractEvalFeatures(Board *board, EvalFeatures *features, bool withMobility); //Count material and piece squares of both sides, mobility and king safety too when asked
+
+bool LoadTunerData(const char *fileName, int threadCount, TunerData *data); //Read a training file ("file.gz" is decompressed) and extract the features of every position
+
+void FreeTunerData(TunerData *data);
+
+double TunerGradient(const TunerData *data, const float *weights, int threadCount, double *gradient); //Mean squared error of the predicted results and its gradient, -1 when out of memory
+
+bool WriteEvalTables(const char *fileName, const float *weights, int positions); //Write the weights as a C header like eval_tables.h
+
+int RunTuner(const char *dataFile, const char *headerFile, int epochs, int threadCount); //Fit the evaluation to the results of a training file with Adam
+
+//##########################-----END OF TUNER FUNCTIONS---------############################
+
+
+
+//##########################-----DISTRIBUTED ANALYSIS FUNCTIONS---------############################
+
+int RunCoordinator(const char *program, const char *fen, int depth, int port, int localWorkers); //Split the root moves of the position between workers and merge their results
+
+int RunWorker(const char *host, int port); //Connect to a coordinator and search the jobs it sends
+
+//##########################-----END OF DISTRIBUTED ANALYSIS FUNCTIONS---------############################
+
+
+
+//##########################-----BENCHMARK FUNCTIONS---------############################
+
+int RunMoveBenchmark(int iterations); //Time the switch based and the table based move validation on mixed positions
+
+//##########################-----END OF BENCHMARK FUNCTIONS---------############################
+
+
+
+//##########################-----ANALYSIS CACHE FUNCTIONS---------############################
+
+AnalysisCache* OpenAnalysisCache(const char *fileName, uint64_t maxBytes); //Map the cache file shared with other processes, create it with at most maxBytes of entries if needed
+
+void CloseAnalysisCache(AnalysisCache *cache); //Unmap the cache file
+
+bool ProbeAnalysisCache(AnalysisCache *cache, uint64_t key, PositionInfo *info); //Look up a position, return false if it is not stored
+
+void StoreAnalysisCache(AnalysisCache *cache, uint64_t key, const PositionInfo *info); //Store a position, replacing the least useful slot of its bucket
+
+void AnalysePosition(Board *board, char sideToMove, PositionInfo *info); //Count the legal moves and find check, mate and stalemate, through the cache when there is one
+
+//##########################-----END OF ANALYSIS CACHE FUNCTIONS---------############################
+
+
+
+//##########################-----BROADCAST FUNCTIONS---------############################
+
+LiveBroadcast* OpenBroadcast(const char *fileName, bool isPublisher); //Map a broadcast file, a publisher creates it if needed, a spectator maps it read only
+
+void CloseBroadcast(LiveBroadcast *broadcast); //Unmap the broadcast file
+
+void PublishPosition(LiveBroadcast *broadcast, uint32_t gameId, Board *board, char sideToMove, const Move *lastMove,
+                     int ply, int status, const Player *white, const Player *black); //Write a frame, never waits for spectators
+
+bool ReadBroadcastFrame(const LiveBroadcast *broadcast, uint64_t number, BroadcastFrame *frame); //Copy frame number, false if it is being written or was overwritten
+
+int RunSpectator(const char *fileName, long gameId); //Follow a broadcast file and print every position of one game until it is mate or stalemate (-1 for all games, never returns)
+
+//##########################-----END OF BROADCAST FUNCTIONS---------############################
+
+
+
+//##########################-----JOURNAL FUNCTIONS---------############################
+
+GameJournal* OpenJournal(const char *fileName); //Open or create a journal, read its records and cut off a record that was not completely written
+
+void CloseJournal(GameJournal *journal); //Write and sync the records that are still buffered, then close the journal
+
+void AppendJournal(GameJournal *journal, int type, uint32_t gameId, int ply, uint16_t move, int seconds); //Buffer a record, the flusher thread writes it soon
+
+bool FindUnfinishedGame(const GameJournal *journal, uint32_t *gameId); //Find the newest game of the journal that has no JOURNAL_END record
+
+int RecoverGame(const GameJournal *journal, uint32_t gameId, Game *game); //Play the journaled moves of a game on a new game, return how many
+
+//##########################-----END OF JOURNAL FUNCTIONS---------############################
+
+
+
+//##########################-----PUZZLE SOLVER FUNCTIONS---------############################
+
+void InitZobrist(void); //Fill the zobrist keys, must be called once before hashing from several threads
+
+bool SolveMate(MateSolver *solver, Board *board, char sideToMove, int mateIn); //Prove or refute a forced mate in mateIn moves with proof-number search
+
+void SolvePuzzle(Puzzle *puzzle, MateSolver *solver); //Find the shortest forced mate of the puzzle and its solution line
+
+int RunPuzzleSolver(const char *fileName, int threadCount); //Solve every puzzle of a file ("FEN;N" per line) on several threads
+
+//##########################-----END OF PUZZLE SOLVER FUNCTIONS---------############################
+
 #endif // CHESS_H_INCLUDED
@@ -4,7 +4,35 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#if !defined(_WIN32)
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/file.h>
+    #include <sys/socket.h>
+    #include <sys/wait.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <netdb.h>
+    #include <poll.h>
+    #include <signal.h>
+    #include <sys/ioctl.h>
+#endif
+#if defined(_WIN32)
+    #include <io.h>
+#endif
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+#endif
 #include "chess.h"
+#include "eval_tables.h"
 
 
 void ClearConsole() {
@@ -32,8 +60,124 @@ void FreeBoard(Board *board); //Free any dynamically allocated memory for the bo
 //##########################-----END OF MEMORY MANAGMENT FUNCTIONS---------############################
 
 
-int main() {
+int main(int argc, char *argv[]) {
     setlocale(LC_CTYPE, "");
+    InitZobrist();
+    InitEvaluation();
+
+    // These options may come before or after the mode, they are taken out of argv so the mode is always argv[1]
+    const char *journalName = NULL;
+    int argumentCount = 1;
+    for (int i = 1; i < argc; i++) {
+        bool isOption = strcmp(argv[i], "--cache") == 0 || strcmp(argv[i], "--broadcast") == 0 ||
+                        strcmp(argv[i], "--journal") == 0;
+        if (!isOption) {
+            argv[argumentCount++] = argv[i];
+            continue;
+        }
+        if (i + 1 == argc) {
+            printf("%s needs a file name.\n", argv[i]);
+            return 1;
+        }
+        // Analysis cache shared with other processes: --cache analysis.bin
+        if (strcmp(argv[i], "--cache") == 0) {
+            analysisCache = OpenAnalysisCache(argv[i + 1], ANALYSIS_CACHE_BYTES);
+        }
+        // Games are published for spectators: --broadcast /dev/shm/chess_live
+        if (strcmp(argv[i], "--broadcast") == 0) {
+            liveBroadcast = OpenBroadcast(argv[i + 1], true);
+        }
+        // Every move is journaled and an unfinished game is resumed: --journal games.journal
+        if (strcmp(argv[i], "--journal") == 0) {
+            journalName = argv[i + 1];
+        }
+        i++;
+    }
+    argc = argumentCount;
+    argv[argc] = NULL;
+
+    // Spectator mode: chess_game --watch /dev/shm/chess_live [game]
+    if (argc >= 3 && strcmp(argv[1], "--watch") == 0) {
+        return RunSpectator(argv[2], (argc >= 4 && isdigit(argv[3][0])) ? atol(argv[3]) : -1);
+    }
+
+    // Puzzle solver mode: chess_game --solve puzzles.txt [threads]
+    if (argc >= 3 && strcmp(argv[1], "--solve") == 0) {
+        int threads = (argc >= 4 && isdigit(argv[3][0])) ? atoi(argv[3]) : GetCoreCount();
+        int result = RunPuzzleSolver(argv[2], threads);
+        CloseAnalysisCache(analysisCache);
+        return result;
+    }
+
+    // Bulk FEN mode: chess_game --fen-stats positions.txt [threads]
+    if (argc >= 3 && strcmp(argv[1], "--fen-stats") == 0) {
+        int threads = (argc >= 4 && isdigit(argv[3][0])) ? atoi(argv[3]) : GetCoreCount();
+        int result = RunFenStats(argv[2], threads);
+        CloseAnalysisCache(analysisCache);
+        return result;
+    }
+
+    // Tournament mode: chess_game --tournament depth=2 depth=3 [games] [threads]
+    if (argc >= 4 && strcmp(argv[1], "--tournament") == 0) {
+        int games = (argc >= 5 && isdigit(argv[4][0])) ? atoi(argv[4]) : 1000;
+        int threads = (argc >= 6 && isdigit(argv[5][0])) ? atoi(argv[5]) : GetCoreCount();
+        int result = RunTournament(argv[2], argv[3], games, threads);
+        CloseAnalysisCache(analysisCache);
+        CloseBroadcast(liveBroadcast);
+        return result;
+    }
+
+    // Distributed analysis: chess_game --analyse "<fen>" depth [port] [local workers]
+    if (argc >= 4 && strcmp(argv[1], "--analyse") == 0) {
+        int port = (argc >= 5 && isdigit(argv[4][0])) ? atoi(argv[4]) : DISTRIBUTED_PORT;
+        int workers = (argc >= 6 && isdigit(argv[5][0])) ? atoi(argv[5]) : GetCoreCount();
+        int result = RunCoordinator(argv[0], argv[2], atoi(argv[3]), port, workers);
+        CloseAnalysisCache(analysisCache);
+        return result;
+    }
+
+    // Worker of a distributed analysis: chess_game --worker host port
+    if (argc >= 4 && strcmp(argv[1], "--worker") == 0) {
+        return RunWorker(argv[2], atoi(argv[3]));
+    }
+
+    // Move validation benchmark: chess_game --bench [iterations]
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        return RunMoveBenchmark((argc >= 3 && isdigit(argv[2][0])) ? atoi(argv[2]) : 200);
+    }
+
+    // Training data: chess_game --generate data.bin games [threads] [engine settings]
+    if (argc >= 4 && strcmp(argv[1], "--generate") == 0) {
+        int threads = (argc >= 5 && isdigit(argv[4][0])) ? atoi(argv[4]) : GetCoreCount();
+        return RunTrainingGenerator(argv[2], atoi(argv[3]), threads, (argc >= 6) ? argv[5] : "depth=2");
+    }
+    if (argc >= 3 && strcmp(argv[1], "--dump") == 0) {
+        return RunTrainingDump(argv[2], (argc >= 4) ? atoi(argv[3]) : 20);
+    }
+
+    // Evaluation tuner: chess_game --tune data.bin eval_tables.h [epochs] [threads]
+    if (argc >= 4 && strcmp(argv[1], "--tune") == 0) {
+        int epochs = (argc >= 5 && isdigit(argv[4][0])) ? atoi(argv[4]) : 500;
+        int threads = (argc >= 6 && isdigit(argv[5][0])) ? atoi(argv[5]) : GetCoreCount();
+        return RunTuner(argv[2], argv[3], epochs, threads);
+    }
+
+    // Replay mode: chess_game --replay game_history.txt
+    if (argc >= 3 && strcmp(argv[1], "--replay") == 0) {
+        int result = RunReplay(argv[2]);
+        CloseAnalysisCache(analysisCache);
+        return result;
+    }
+
+    // The interactive game takes no arguments, anything left is a mistyped mode or a mode without its arguments
+    if (argc >= 2) {
+        printf("Unknown mode or missing arguments: %s\n", argv[1]);
+        printf("Modes: --watch, --solve, --fen-stats, --tournament, --analyse, --worker, --bench, --generate, "
+               "--dump, --tune, --replay, or none for a game. --cache, --broadcast and --journal may go with them.\n");
+        CloseAnalysisCache(analysisCache);
+        CloseBroadcast(liveBroadcast);
+        return 1;
+    }
 
     // Initialize game components
     Board board;
@@ -50,9 +194,54 @@ int main() {
     game.players[1] = &player2;
     game.currentPlayer = 0; // Player 1 (White) starts
     game.moveCount = 0;     // Initialize move count
+    game.journal = NULL;
+    game.id = 0;
+
+    int resumedMoves = -1;
+    uint32_t finishedGame = 0;
+    if (journalName != NULL) {
+        game.journal = OpenJournal(journalName);
+        if (game.journal == NULL) {
+            CloseAnalysisCache(analysisCache);
+            CloseBroadcast(liveBroadcast);
+            return 1;
+        }
+        if (FindUnfinishedGame(game.journal, &game.id)) {
+            resumedMoves = RecoverGame(game.journal, game.id, &game);
+
+            // The process may have died between the last move and the end record, such a game is not resumed
+            PositionInfo info;
+            AnalysePosition(game.board, game.players[game.currentPlayer]->color, &info);
+            if (player1.isLost || player2.isLost || info.status == POSITION_CHECKMATE || info.status == POSITION_STALEMATE) {
+                AppendJournal(game.journal, JOURNAL_END, game.id, game.moveCount, 0, 0);
+                finishedGame = game.id;
+                FreeBoard(&board);
+                InitializeBoard(&board);
+                InitializePlayers(&player1, &player2);
+                game.currentPlayer = 0;
+                game.moveCount = 0;
+                resumedMoves = -1;
+            }
+        }
+        if (resumedMoves < 0) {
+            game.id = game.journal->nextGameId;
+            AppendJournal(game.journal, JOURNAL_START, game.id, 0, 0, (int)player1.timeLeft);
+        }
+    }
 
     // Print the initial board state
     PrintBoard(&board, &game);
+    if (finishedGame != 0) {
+        printf("Game %u of %s was already over, a new game starts.\n", finishedGame, journalName);
+    }
+    if (resumedMoves >= 0) {
+        printf("Resumed game %u of %s after %d moves.\n", game.id, journalName, resumedMoves);
+    }
+    if (liveBroadcast != NULL) {
+        PublishPosition(liveBroadcast, game.id, &board, game.players[game.currentPlayer]->color,
+                        (game.moveCount > 0) ? &game.moveHistory[game.moveCount - 1] : NULL, game.moveCount,
+                        POSITION_NORMAL, &player1, &player2);
+    }
 
     // Main game loop
     while (!isGameOver) {
@@ -72,17 +261,29 @@ int main() {
             // Update time left for the current player
             UpdateTimeLeft(currentPlayer);
 
-            // Check if the opponent is in check after the move
-            if (isCheck(game.board, opponentPlayer))
+            // Check if the opponent is in check, checkmate or stalemate after the move
+            PositionInfo info;
+            AnalysePosition(game.board, opponentPlayer->color, &info);
+            opponentPlayer->isInCheck = (info.status == POSITION_CHECK || info.status == POSITION_CHECKMATE);
+            if (info.status == POSITION_CHECK)
                     printf("Player %d is in check!\n", 1 - game.currentPlayer + 1);
 
-                // Check if the opponent is in checkmate
-                if (isCheckmate(game.board, opponentPlayer))
+                if (info.status == POSITION_CHECKMATE)
                 {
                     printf("Player %d is in checkmate. Player %d wins!\n", 1 - game.currentPlayer + 1, game.currentPlayer + 1);
                     isGameOver = true;
                 }
 
+                if (info.status == POSITION_STALEMATE)
+                {
+                    printf("Player %d has no legal move. The game is a draw!\n", 1 - game.currentPlayer + 1);
+                    isGameOver = true;
+                }
+
+            if (liveBroadcast != NULL) {
+                PublishPosition(liveBroadcast, game.id, &board, opponentPlayer->color, &game.moveHistory[game.moveCount - 1],
+                                game.moveCount, info.status, &player1, &player2);
+            }
 
             // Check if the game is over due to time constraints
             if (currentPlayer->isLost) {
@@ -100,13 +301,35 @@ int main() {
         }
     }
 
+    if (game.journal != NULL) {
+        AppendJournal(game.journal, JOURNAL_END, game.id, game.moveCount, 0, 0);
+        CloseJournal(game.journal);
+    }
+    CloseAnalysisCache(analysisCache);
+    CloseBroadcast(liveBroadcast);
     return 0;
 }
 
 
 void ConvertAlgebraicToIndices(const char* position, int* x, int* y) {
     *y = toupper(position[0]) - 'A'; // Column (A-H) to index (0-7)
-    *x = 8 - (position[1] - '0'); // Row (1-8) to index (0-7)
+    *x = position[1] - '1'; // Row (1-8) to index (0-7), white starts on rows 1 and 2
+}
+
+void ConvertIndicesToAlgebraic(int x, int y, char* position) {
+    position[0] = 'A' + y; // Index (0-7) to column (A-H)
+    position[1] = '1' + x; // Index (0-7) to row (1-8)
+    position[2] = '\0';
+}
+
+int GetCoreCount(void) {
+    #if defined(_WIN32)
+        const char *count = getenv("NUMBER_OF_PROCESSORS"); // For Windows
+        return (count != NULL && atoi(count) > 0) ? atoi(count) : 1;
+    #else
+        long count = sysconf(_SC_NPROCESSORS_ONLN); // For Linux and macOS
+        return (count > 0) ? (int)count : 1;
+    #endif
 }
 
 void PrintBoard(Board *board, Game *game) {
@@ -116,8 +339,8 @@ void PrintBoard(Board *board, Game *game) {
     printf("      A     B     C     D     E     F     G     H\n");
     printf("  +-----+-----+-----+-----+-----+-----+-----+-----+\n");
 
-    for (int i = 0; i < 8; i++) {
-        printf("%d |", 8 - i); // Print the row label correctly
+    for (int i = 7; i >= 0; i--) {
+        printf("%d |", i + 1); // Print the row label correctly, row 8 on top
 
         for (int j = 0; j < 8; j++) {
             if (board->board[i][j] == NULL) {
@@ -128,7 +351,7 @@ void PrintBoard(Board *board, Game *game) {
                 printf(" %s |", symbol); // Print piece symbol with color
             }
         }
-        printf(" %d\n", 8 - i); // Print the row label correctly
+        printf(" %d\n", i + 1); // Print the row label correctly
 
         // Print the separator line
         printf("  +-----+-----+-----+-----+-----+-----+-----+-----+\n");
@@ -203,6 +426,7 @@ void InitializeBoard(Board *board) {
         piece->x = x;
         piece->y = y;
         piece->hasMoved = false;
+        piece->code = PieceCodeFromType(type, color);
         board->board[x][y] = piece;
     }
 
@@ -384,33 +608,46 @@ bool MoveKnight(Board *board, int startX, int startY, int endX, int endY, Player
     return false;
 }
 
-bool MovePawn(Board *board, int startX, int startY, int endX, int endY, Player *player) {
-    Piece *pawn = board->board[startX][startY];
-    int direction = (pawn->color == 'W') ? 1 : -1;
-
-    // Normal move
-    if (startY == endY && board->board[endX][endY] == NULL) {
-        if (endX == startX + direction) { // Single step forward
-            return true;
-        }
-        if (!pawn->hasMoved && endX == startX + 2 * direction && board->board[startX + direction][startY] == NULL) { // Double step forward
-            return true;
-        }
-    }
+// The pawn rules for one color. The direction is a constant, so every color gets its own
+// copy without the color test.
+#define DEFINE_PAWN_MOVE(name, direction)                                                                  \
+bool name(Board *board, int startX, int startY, int endX, int endY, Player *player) {                      \
+    Piece *pawn = board->board[startX][startY];                                                          \
+    Piece *destination = board->board[endX][endY];                                                       \
+                                                                                                         \
+    /* Normal move, a single step or a double step from the starting row */                              \
+    if (startY == endY && destination == NULL) {                                                         \
+        if (endX == startX + (direction)) {                                                              \
+            return true;                                                                                 \
+        }                                                                                                \
+        if (!pawn->hasMoved && endX == startX + 2 * (direction) && board->board[startX + (direction)][startY] == NULL) { \
+            return true;                                                                                 \
+        }                                                                                                \
+    }                                                                                                    \
+                                                                                                         \
+    /* Capture move */                                                                                   \
+    return abs(startY - endY) == 1 && endX == startX + (direction) && destination != NULL && destination->color != pawn->color; \
+}
 
-    // Capture move
-    if (abs(startY - endY) == 1 && endX == startX + direction && board->board[endX][endY] != NULL && board->board[endX][endY]->color != pawn->color) {
-        return true;
-    }
+DEFINE_PAWN_MOVE(MovePawnWhite, 1)
+DEFINE_PAWN_MOVE(MovePawnBlack, -1)
 
-    // En Passant (requires additional logic to handle)
-    // if (/* conditions for en passant */) {
-    //     return true;
-    // }
+bool MovePawn(Board *board, int startX, int startY, int endX, int endY, Player *player) {
+    // En Passant is not handled by the movement rules, see CountEnPassantMoves
+    return (board->board[startX][startY]->code & 8) ? MovePawnBlack(board, startX, startY, endX, endY, player)
+                                                     : MovePawnWhite(board, startX, startY, endX, endY, player);
+}
 
+bool MoveNone(Board *board, int startX, int startY, int endX, int endY, Player *player) {
     return false;
 }
 
+// The movement rules of every piece code: 1-6 white P N B R Q K, 9-14 black
+static const MoveFunction moveFunctions[16] = {
+    MoveNone, MovePawnWhite, MoveKnight, MoveBishop, MoveRook, MoveQueen, MoveKing, MoveNone,
+    MoveNone, MovePawnBlack, MoveKnight, MoveBishop, MoveRook, MoveQueen, MoveKing, MoveNone
+};
+
 void StoreMove(Game *game, Move *move) {
     if (game->moveCount < MAX_MOVES) {
         game->moveHistory[game->moveCount] = *move;
@@ -439,27 +676,7 @@ bool PerformMove(Game* game, const char* moveInput) {
         return false;
     }
 
-    bool isValidMove = false;
-    switch (toupper(movingPiece->type)) {
-        case 'K':
-            isValidMove =  MoveKing(board, startX, startY, endX, endY, currentPlayer);
-            break;
-        case 'Q':
-            isValidMove = MoveQueen(board, startX, startY, endX, endY, currentPlayer);
-            break;
-        case 'R':
-            isValidMove = MoveRook(board, startX, startY, endX, endY, currentPlayer);
-            break;
-        case 'B':
-            isValidMove = MoveBishop(board, startX, startY, endX, endY, currentPlayer);
-            break;
-        case 'N':
-            isValidMove = MoveKnight(board, startX, startY, endX, endY, currentPlayer);
-            break;
-        case 'P':
-            isValidMove = MovePawn(board, startX, startY, endX, endY, currentPlayer);
-            break;
-    }
+    bool isValidMove = moveFunctions[movingPiece->code](board, startX, startY, endX, endY, currentPlayer);
 
     if (!isValidMove) {
         printf("Invalid move for the selected piece.\n");
@@ -487,7 +704,12 @@ bool PerformMove(Game* game, const char* moveInput) {
 
     // Store the move
     Move move = {startX, startY, endX, endY, movingPiece->type, capturedPiece ? capturedPiece->type : 0, false, false, false, game->currentPlayer};
+    snprintf(move.move, sizeof(move.move), "%.5s", moveInput);
     StoreMove(game, &move);
+    if (game->journal != NULL) {
+        int seconds = (int)difftime(time(NULL), currentPlayer->startTime);
+        AppendJournal(game->journal, JOURNAL_MOVE, game->id, game->moveCount, PackMove(&move), seconds);
+    }
 
 
 
@@ -509,11 +731,9 @@ void saveGameHistory(Game *game) {
         return;
     }
 
-    // Write game history to file
-    Move *current = game->moveHistory;
-    while (current != NULL) {
-        fprintf(file, "%s\n", current->move);
-        current = current->next;
+    // Write game history to file, one move per line
+    for (int i = 0; i < game->moveCount; i++) {
+        fprintf(file, "%s\n", game->moveHistory[i].move);
     }
 
     // Close the file
@@ -544,25 +764,8 @@ bool IsLegalMove(Board *board, int startX, int startY, int endX, int endY, Playe
         return false; // Can't capture own piece
     }
 
-    // Call the appropriate movement function based on the type of the piece
-    switch (toupper(movingPiece->type)) {
-        case 'K': // King
-            return MoveKing(board, startX, startY, endX, endY, player);
-        case 'Q': // Queen
-            return MoveQueen(board, startX, startY, endX, endY, player);
-        case 'R': // Rook
-            return MoveRook(board, startX, startY, endX, endY, player);
-        case 'B': // Bishop
-            return MoveBishop(board, startX, startY, endX, endY, player);
-        case 'N': // Knight
-            return MoveKnight(board, startX, startY, endX, endY, player);
-        case 'P': // Pawn
-            return MovePawn(board, startX, startY, endX, endY, player);
-        default:
-            return false; // Invalid piece type
-    }
-
-    return false; // Default case, should never reach here
+    // Call the movement function of the piece code
+    return moveFunctions[movingPiece->code](board, startX, startY, endX, endY, player);
 }
 
 bool IsMoveWithinBounds(int startX, int startY, int endX, int endY) {
@@ -711,35 +914,3751 @@ bool CanPieceAttack(Piece *piece, int targetX, int targetY, Board *board, Player
     // For example, check if the piece can move to (targetX, targetY)
     // Return true if the piece can attack the given coordinates
 
-    bool isValidMove = false;
+    // The movement function of the piece code, empty codes never attack
+    return moveFunctions[piece->code](board, piece->x, piece->y, targetX, targetY, currentPlayer);
+}
 
-    // Ensure we're using the piece->type for switch case
-    switch (toupper(piece->type)) {
-        case 'K':
-            isValidMove = MoveKing(board, piece->x, piece->y, targetX, targetY, currentPlayer);
-            break;
-        case 'Q':
-            isValidMove = MoveQueen(board, piece->x, piece->y, targetX, targetY, currentPlayer);
-            break;
-        case 'R':
-            isValidMove = MoveRook(board, piece->x, piece->y, targetX, targetY, currentPlayer);
-            break;
-        case 'B':
-            isValidMove = MoveBishop(board, piece->x, piece->y, targetX, targetY, currentPlayer);
-            break;
-        case 'N':
-            isValidMove = MoveKnight(board, piece->x, piece->y, targetX, targetY, currentPlayer);
-            break;
-        case 'P':
-            isValidMove = MovePawn(board, piece->x, piece->y, targetX, targetY, currentPlayer);
-            break;
-        default:
-            // Handle unexpected piece types, possibly an error
-            break;
+
+
+void FreeBoard(Board *board) {
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            free(board->board[i][j]); // free(NULL) does nothing for empty squares
+            board->board[i][j] = NULL;
+        }
+    }
+}
+
+
+
+//##########################-----POSITION FUNCTIONS---------############################
+
+static uint64_t zobristPieces[12][BOARD_SIZE][BOARD_SIZE]; // a key for every piece on every square
+static uint64_t zobristSide;                               // xor-ed in when black is to move
+static uint64_t zobristDepth[64];                          // xor-ed in by the solver for the moves left
+static uint64_t zobristCastling[2][2];                     // xor-ed in for every castling right left
+
+Piece* CreatePiece(int x, int y, char type, char color) {
+    Piece *piece = (Piece*)malloc(sizeof(Piece));
+    piece->type = type;
+    piece->color = color;
+    piece->x = x;
+    piece->y = y;
+    piece->hasMoved = false;
+    piece->code = PieceCodeFromType(type, color);
+    return piece;
+}
+
+void ClearBoard(Board *board) {
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            board->board[i][j] = NULL;
+        }
+    }
+}
+
+// What every FEN character means: a PieceCode, -n for n empty squares, 16 for the end of a row, 0 for an error
+static const int8_t fenCodes[256] = {
+    ['P'] = 1, ['N'] = 2, ['B'] = 3, ['R'] = 4, ['Q'] = 5, ['K'] = 6,
+    ['p'] = 9, ['n'] = 10, ['b'] = 11, ['r'] = 12, ['q'] = 13, ['k'] = 14,
+    ['1'] = -1, ['2'] = -2, ['3'] = -3, ['4'] = -4, ['5'] = -5, ['6'] = -6, ['7'] = -7, ['8'] = -8,
+    ['/'] = 16
+};
+
+Piece* CreatePieceFromCode(int x, int y, int code) {
+    char color = (code & 8) ? 'B' : 'W';
+    char type = "PNBRQK"[(code & 7) - 1];
+    Piece *piece = CreatePiece(x, y, (color == 'W') ? type : tolower(type), color);
+
+    // A pawn that left its starting row can not double step anymore
+    if (type == 'P') {
+        piece->hasMoved = (color == 'W') ? (x != 1) : (x != 6);
+    }
+    // Kings and rooks have no castling rights until they are given back
+    if (type == 'K' || type == 'R') {
+        piece->hasMoved = true;
+    }
+    return piece;
+}
+
+// Give back the castling rights (bits of CastlingRights) whose king and rook are in place
+static void SetCastlingRights(Board *board, int rights) {
+    for (int bit = 0; bit < 4; bit++) {
+        int row = (bit < 2) ? 0 : 7;
+        Piece *king = board->board[row][4];
+        Piece *rook = board->board[row][(bit % 2 == 0) ? 7 : 0];
+        if ((rights & (1 << bit)) && king != NULL && toupper(king->type) == 'K' &&
+            rook != NULL && toupper(rook->type) == 'R' && rook->color == king->color) {
+            king->hasMoved = false;
+            rook->hasMoved = false;
+        }
+    }
+}
+
+bool ParseFEN(Board *board, const char *fen, FenState *state) {
+    const unsigned char *c = (const unsigned char*)fen;
+    int x = 7; // FEN starts with row 8
+    int y = 0;
+
+    // Piece placement, one table lookup for every character
+    for (; *c != '\0' && *c != ' '; c++) {
+        int code = fenCodes[*c];
+        if (code > 0 && code < 16 && y < BOARD_SIZE) {
+            board->board[x][y] = CreatePieceFromCode(x, y, code);
+            y++;
+        } else if (code < 0) {
+            y -= code;
+        } else if (code == 16 && y == BOARD_SIZE && x > 0) {
+            x--;
+            y = 0;
+        } else {
+            return false;
+        }
+        if (y > BOARD_SIZE) {
+            return false;
+        }
+    }
+    if (x != 0 || y != BOARD_SIZE) {
+        return false;
+    }
+
+    // Side to move
+    while (*c == ' ') c++;
+    if (*c != 'w' && *c != 'b') {
+        return false;
+    }
+    state->sideToMove = (*c++ == 'w') ? 'W' : 'B';
+
+    // Castling rights
+    state->castling = 0;
+    while (*c == ' ') c++;
+    if (*c == '-') {
+        c++;
+    } else {
+        for (; *c != '\0' && *c != ' '; c++) {
+            const char *rights = "KQkq";
+            const char *right = strchr(rights, *c);
+            if (right == NULL) {
+                return false;
+            }
+            state->castling |= 1 << (right - rights);
+        }
+    }
+    SetCastlingRights(board, state->castling);
+
+    // En passant target square, the last two fields are optional
+    state->enPassantX = -1;
+    state->enPassantY = -1;
+    state->halfmoveClock = 0;
+    state->fullmoveNumber = 1;
+    while (*c == ' ') c++;
+    if (*c == '\0') {
+        return true;
+    }
+    if (*c >= 'a' && *c <= 'h' && c[1] >= '1' && c[1] <= '8') {
+        ConvertAlgebraicToIndices((const char*)c, &state->enPassantX, &state->enPassantY);
+        c += 2;
+    } else if (*c == '-') {
+        c++;
+    } else {
+        return false;
+    }
+    if (*c != '\0' && *c != ' ') {
+        return false;
+    }
+    // The clocks are optional too, but must be in range when they are there
+    char *end;
+    long halfmoveClock = strtol((const char*)c, &end, 10);
+    if (end != (const char*)c) {
+        if (halfmoveClock < 0 || halfmoveClock > FEN_MAX_CLOCK) {
+            return false;
+        }
+        state->halfmoveClock = (int)halfmoveClock;
+        c = (const unsigned char*)end;
+        long fullmoveNumber = strtol((const char*)c, &end, 10);
+        if (end != (const char*)c) {
+            if (fullmoveNumber < 1 || fullmoveNumber > FEN_MAX_CLOCK) {
+                return false;
+            }
+            state->fullmoveNumber = (int)fullmoveNumber;
+            c = (const unsigned char*)end;
+        }
+    }
+    while (*c == ' ') c++;
+    return *c == '\0';
+}
+
+bool LoadFEN(Board *board, const char *fen, char *sideToMove) {
+    FenState state;
+    if (!ParseFEN(board, fen, &state)) {
+        return false;
+    }
+    *sideToMove = state.sideToMove;
+    return true;
+}
+
+char OpponentColor(char color) {
+    return (color == 'W') ? 'B' : 'W';
+}
+
+bool IsSquareAttacked(Board *board, int x, int y, char attackerColor) {
+    // A scratch player so the movement functions compare against the attacker color
+    // and their castling bookkeeping does not touch the real players
+    Player attacker = {0};
+    attacker.color = attackerColor;
+    attacker.hasMovedKing = true;
+    attacker.hasMovedRook = true;
+    int pawnDirection = (attackerColor == 'W') ? 1 : -1;
+
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            Piece *piece = board->board[i][j];
+            if (piece == NULL || piece->color != attackerColor || (i == x && j == y)) {
+                continue;
+            }
+            switch (piece->code & 7) {
+                case 1: // Pawns only attack diagonally forward, even on an empty square
+                    if (x == i + pawnDirection && abs(y - j) == 1) {
+                        return true;
+                    }
+                    break;
+                case 6: // Kings only attack the squares around them, never by castling
+                    if (abs(x - i) <= 1 && abs(y - j) <= 1) {
+                        return true;
+                    }
+                    break;
+                default:
+                    if (moveFunctions[piece->code](board, i, j, x, y, &attacker)) {
+                        return true;
+                    }
+                    break;
+            }
+        }
+    }
+    return false;
+}
+
+bool IsKingInCheck(Board *board, char color) {
+    int kingCode = PieceCodeFromType('K', color);
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            Piece *piece = board->board[i][j];
+            if (piece != NULL && piece->code == kingCode) {
+                return IsSquareAttacked(board, i, j, OpponentColor(color));
+            }
+        }
+    }
+    return false; // No king on the board
+}
+
+bool CanCastle(Board *board, Piece *king, int endY) {
+    int row = (king->color == 'W') ? 0 : 7;
+    int rookY = (endY == 6) ? 7 : 0;
+    int passY = (endY == 6) ? 5 : 3;
+
+    if (king->hasMoved || king->x != row || king->y != 4) {
+        return false;
+    }
+    Piece *rook = board->board[row][rookY];
+    if (rook == NULL || rook->color != king->color || toupper(rook->type) != 'R' || rook->hasMoved) {
+        return false;
+    }
+
+    // MoveKing checks the square next to the king, the rest of the path must be empty too
+    Player player = {0};
+    player.color = king->color;
+    if (!MoveKing(board, row, 4, row, endY, &player)) {
+        return false;
+    }
+    for (int y = min(rookY, 4) + 1; y < max(rookY, 4); y++) {
+        if (board->board[row][y] != NULL) {
+            return false;
+        }
+    }
+
+    // The king can not castle out of check or through an attacked square
+    char opponent = OpponentColor(king->color);
+    return !IsSquareAttacked(board, row, 4, opponent) && !IsSquareAttacked(board, row, passY, opponent);
+}
+
+bool IsPseudoLegalMove(Board *board, Piece *piece, int endX, int endY) {
+    if ((piece->code & 7) == 6 && piece->x == endX && abs(endY - piece->y) == 2) {
+        return CanCastle(board, piece, endY);
+    }
+
+    // A scratch player, the movement functions update the king and rook flags of the player they get
+    Player player = {0};
+    player.color = piece->color;
+    player.hasMovedKing = true;
+    player.hasMovedRook = true;
+    return IsLegalMove(board, piece->x, piece->y, endX, endY, &player);
+}
+
+int GenerateLegalMoves(Board *board, char color, Move *moves) {
+    int count = 0;
+
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            Piece *piece = board->board[i][j];
+            if (piece == NULL || piece->color != color) {
+                continue;
+            }
+            for (int x = 0; x < BOARD_SIZE; x++) {
+                for (int y = 0; y < BOARD_SIZE; y++) {
+                    if ((x == i && y == j) || !IsPseudoLegalMove(board, piece, x, y)) {
+                        continue;
+                    }
+
+                    Move move = {0};
+                    move.startX = i;
+                    move.startY = j;
+                    move.endX = x;
+                    move.endY = y;
+                    move.pieceMoved = piece->type;
+                    move.pieceCaptured = board->board[x][y] ? board->board[x][y]->type : 0;
+                    move.isCastlingMove = (piece->code & 7) == 6 && abs(y - j) == 2;
+                    move.isPromotion = (piece->code & 7) == 1 && (x == 0 || x == 7);
+                    move.playerWhoMadeTheMove = (color == 'W') ? 0 : 1;
+
+                    // The move is legal only if it does not leave the own king in check
+                    MoveUndo undo;
+                    MakeMove(board, &move, &undo);
+                    bool isLegal = !IsKingInCheck(board, color);
+                    UnmakeMove(board, &move, &undo);
+
+                    if (isLegal) {
+                        moves[count++] = move;
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+void MakeMove(Board *board, const Move *move, MoveUndo *undo) {
+    Piece *piece = board->board[move->startX][move->startY];
+
+    undo->captured = board->board[move->endX][move->endY];
+    undo->originalType = piece->type;
+    undo->pieceHadMoved = piece->hasMoved;
+    undo->rookHadMoved = false;
+
+    board->board[move->endX][move->endY] = piece;
+    board->board[move->startX][move->startY] = NULL;
+    piece->x = move->endX;
+    piece->y = move->endY;
+    piece->hasMoved = true;
+
+    if (move->isPromotion) {
+        piece->type = (piece->color == 'W') ? 'Q' : 'q'; // Always promote to a queen
+        piece->code = (piece->code & 8) | 5;
+    }
+
+    if (move->isCastlingMove) {
+        int rookStartY = (move->endY == 6) ? 7 : 0;
+        int rookEndY = (move->endY == 6) ? 5 : 3;
+        Piece *rook = board->board[move->endX][rookStartY];
+        undo->rookHadMoved = rook->hasMoved;
+        board->board[move->endX][rookEndY] = rook;
+        board->board[move->endX][rookStartY] = NULL;
+        rook->y = rookEndY;
+        rook->hasMoved = true;
     }
+}
+
+void UnmakeMove(Board *board, const Move *move, const MoveUndo *undo) {
+    Piece *piece = board->board[move->endX][move->endY];
+
+    board->board[move->startX][move->startY] = piece;
+    board->board[move->endX][move->endY] = undo->captured;
+    piece->x = move->startX;
+    piece->y = move->startY;
+    piece->hasMoved = undo->pieceHadMoved;
+    piece->type = undo->originalType;
+    piece->code = PieceCodeFromType(piece->type, piece->color);
+
+    if (move->isCastlingMove) {
+        int rookStartY = (move->endY == 6) ? 7 : 0;
+        int rookEndY = (move->endY == 6) ? 5 : 3;
+        Piece *rook = board->board[move->endX][rookEndY];
+        board->board[move->endX][rookStartY] = rook;
+        board->board[move->endX][rookEndY] = NULL;
+        rook->y = rookStartY;
+        rook->hasMoved = undo->rookHadMoved;
+    }
+}
+
+// Index of the piece in the zobrist table: P N B R Q K for white, then the same for black
+static int ZobristIndex(Piece *piece) {
+    return (piece->code & 7) - 1 + ((piece->code >> 3) * 6);
+}
 
-    return isValidMove;
+// splitmix64, gives the same keys on every run
+static uint64_t NextRandom(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
 }
 
+// Castling rights as 4 bits: white short, white long, black short, black long.
+// A right is left while the king and that rook have not moved.
+static int CastlingRights(Board *board) {
+    int rights = 0;
+    for (int c = 0; c < 2; c++) {
+        int row = (c == 0) ? 0 : 7;
+        Piece *king = board->board[row][4];
+        if (king == NULL || toupper(king->type) != 'K' || king->hasMoved) {
+            continue;
+        }
+        for (int side = 0; side < 2; side++) {
+            Piece *rook = board->board[row][(side == 0) ? 7 : 0];
+            if (rook != NULL && toupper(rook->type) == 'R' && rook->color == king->color && !rook->hasMoved) {
+                rights |= 1 << (c * 2 + side);
+            }
+        }
+    }
+    return rights;
+}
 
+void InitZobrist(void) {
+    uint64_t state = 2024;
+    for (int p = 0; p < 12; p++) {
+        for (int i = 0; i < BOARD_SIZE; i++) {
+            for (int j = 0; j < BOARD_SIZE; j++) {
+                zobristPieces[p][i][j] = NextRandom(&state);
+            }
+        }
+    }
+    zobristSide = NextRandom(&state);
+    for (int d = 0; d < 64; d++) {
+        zobristDepth[d] = NextRandom(&state);
+    }
+    for (int c = 0; c < 2; c++) {
+        zobristCastling[c][0] = NextRandom(&state);
+        zobristCastling[c][1] = NextRandom(&state);
+    }
+}
+
+uint64_t HashBoard(Board *board, char sideToMove) {
+    uint64_t key = (sideToMove == 'B') ? zobristSide : 0;
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            Piece *piece = board->board[i][j];
+            if (piece != NULL) {
+                key ^= zobristPieces[ZobristIndex(piece)][i][j];
+            }
+        }
+    }
+
+    int rights = CastlingRights(board);
+    for (int bit = 0; bit < 4; bit++) {
+        if (rights & (1 << bit)) {
+            key ^= zobristCastling[bit / 2][bit % 2];
+        }
+    }
+    return key;
+}
+
+void MoveToString(const Move *move, char *out) {
+    ConvertIndicesToAlgebraic(move->startX, move->startY, out);
+    out[2] = '-';
+    ConvertIndicesToAlgebraic(move->endX, move->endY, out + 3);
+}
+
+int PieceCode(Piece *piece) {
+    return (piece == NULL) ? 0 : piece->code;
+}
+
+int PieceCodeFromType(char type, char color) {
+    const char *order = "PNBRQK";
+    const char *found = strchr(order, toupper(type));
+    if (type == '\0' || found == NULL) {
+        return 0;
+    }
+    return (int)(found - order) + 1 + ((color == 'W') ? 0 : 8);
+}
+
+void TakeSnapshot(Board *board, char sideToMove, PositionSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(PositionSnapshot));
+    for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++) {
+        int code = PieceCode(board->board[square / BOARD_SIZE][square % BOARD_SIZE]);
+        snapshot->squares[square / 2] |= code << (4 * (square % 2));
+    }
+    snapshot->flags = (sideToMove == 'B' ? 1 : 0) | (CastlingRights(board) << 1);
+}
+
+void RestoreSnapshot(const PositionSnapshot *snapshot, Board *board, char *sideToMove) {
+    for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++) {
+        int code = (snapshot->squares[square / 2] >> (4 * (square % 2))) & 0xF;
+        int x = square / BOARD_SIZE;
+        int y = square % BOARD_SIZE;
+        board->board[x][y] = (code == 0) ? NULL : CreatePieceFromCode(x, y, code);
+    }
+    SetCastlingRights(board, snapshot->flags >> 1);
+    *sideToMove = (snapshot->flags & 1) ? 'B' : 'W';
+}
+
+bool WriteFEN(Board *board, const FenState *state, char *out, size_t size) {
+    // Every field has a fixed largest length, so the string is built here and copied when it fits
+    char fen[128];
+    char *c = fen;
+
+    for (int x = 7; x >= 0; x--) {
+        int empty = 0;
+        for (int y = 0; y < BOARD_SIZE; y++) {
+            Piece *piece = board->board[x][y];
+            if (piece == NULL) {
+                empty++;
+                continue;
+            }
+            if (empty > 0) {
+                *c++ = '0' + empty;
+                empty = 0;
+            }
+            *c++ = (piece->color == 'W') ? toupper(piece->type) : tolower(piece->type);
+        }
+        if (empty > 0) {
+            *c++ = '0' + empty;
+        }
+        if (x > 0) {
+            *c++ = '/';
+        }
+    }
+
+    *c++ = ' ';
+    *c++ = (state->sideToMove == 'W') ? 'w' : 'b';
+    *c++ = ' ';
+    int rights = CastlingRights(board);
+    for (int bit = 0; bit < 4; bit++) {
+        if (rights & (1 << bit)) {
+            *c++ = "KQkq"[bit];
+        }
+    }
+    if (rights == 0) {
+        *c++ = '-';
+    }
+    *c++ = ' ';
+    if (state->enPassantX >= 0) {
+        *c++ = 'a' + state->enPassantY;
+        *c++ = '1' + state->enPassantX;
+    } else {
+        *c++ = '-';
+    }
+    snprintf(c, sizeof(fen) - (c - fen), " %d %d", state->halfmoveClock, state->fullmoveNumber);
+    size_t length = strlen(fen);
+    if (length >= size) {
+        return false;
+    }
+    memcpy(out, fen, length + 1);
+    return true;
+}
+
+const char* ValidatePosition(Board *board, const FenState *state) {
+    int kings[2] = {0, 0};
+    int pawns[2] = {0, 0};
+    int pieces[2] = {0, 0};
+
+    for (int i = 0; i < BOARD_SIZE; i++) {
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            Piece *piece = board->board[i][j];
+            if (piece == NULL) {
+                continue;
+            }
+            int side = (piece->color == 'W') ? 0 : 1;
+            pieces[side]++;
+            kings[side] += toupper(piece->type) == 'K';
+            pawns[side] += toupper(piece->type) == 'P';
+            if (toupper(piece->type) == 'P' && (i == 0 || i == 7)) {
+                return "pawn on the first or last row";
+            }
+        }
+    }
+
+    if (kings[0] != 1 || kings[1] != 1) {
+        return "each side needs exactly one king";
+    }
+    if (pawns[0] > 8 || pawns[1] > 8 || pieces[0] > 16 || pieces[1] > 16) {
+        return "too many pieces";
+    }
+    if (IsKingInCheck(board, OpponentColor(state->sideToMove))) {
+        return "the side not to move is in check";
+    }
+    if ((state->castling & ~CastlingRights(board)) != 0) {
+        return "castling right without its king and rook";
+    }
+
+    if (state->enPassantX >= 0) {
+        // The pawn that just double stepped stands in front of the target square
+        // Check the row first, only then the squares next to it are on the board
+        int direction = (state->sideToMove == 'W') ? -1 : 1;
+        int row = (state->sideToMove == 'W') ? 5 : 2;
+        if (state->enPassantX != row) {
+            return "en passant square without a pawn that just double stepped";
+        }
+        Piece *pawn = board->board[state->enPassantX + direction][state->enPassantY];
+        if (board->board[state->enPassantX][state->enPassantY] != NULL ||
+            board->board[state->enPassantX - direction][state->enPassantY] != NULL ||
+            pawn == NULL || toupper(pawn->type) != 'P' || pawn->color == state->sideToMove) {
+            return "en passant square without a pawn that just double stepped";
+        }
+    }
+    return NULL;
+}
+
+int CountEnPassantMoves(Board *board, const FenState *state) {
+    if (state->enPassantX < 0) {
+        return 0;
+    }
+
+    int count = 0;
+    int direction = (state->sideToMove == 'W') ? 1 : -1;
+    int fromX = state->enPassantX - direction;
+    Piece *captured = board->board[fromX][state->enPassantY];
+
+    for (int side = -1; side <= 1; side += 2) {
+        int fromY = state->enPassantY + side;
+        if (fromY < 0 || fromY >= BOARD_SIZE) {
+            continue;
+        }
+        Piece *pawn = board->board[fromX][fromY];
+        if (pawn == NULL || pawn->color != state->sideToMove || toupper(pawn->type) != 'P') {
+            continue;
+        }
+
+        // Play the capture, both pawns leave their row so look for a check along it too
+        board->board[state->enPassantX][state->enPassantY] = pawn;
+        board->board[fromX][fromY] = NULL;
+        board->board[fromX][state->enPassantY] = NULL;
+        pawn->x = state->enPassantX;
+        pawn->y = state->enPassantY;
+
+        count += !IsKingInCheck(board, state->sideToMove);
+
+        board->board[fromX][fromY] = pawn;
+        board->board[fromX][state->enPassantY] = captured;
+        board->board[state->enPassantX][state->enPassantY] = NULL;
+        pawn->x = fromX;
+        pawn->y = fromY;
+    }
+    return count;
+}
+
+//##########################-----END OF POSITION FUNCTIONS---------############################
+
+
+
+//##########################-----REPLAY FUNCTIONS---------############################
+
+bool uploadGame(const char *fileName, GameReplay *replay) {
+    FILE *file = fopen(fileName, "r");
+    if (file == NULL) {
+        printf("Error opening file %s for reading.\n", fileName);
+        return false;
+    }
+
+    InitializeBoard(&replay->board);
+    replay->sideToMove = 'W';
+    replay->moveCount = 0;
+
+    // Play every move of the file once, keeping a snapshot every REPLAY_KEYFRAME_INTERVAL plies
+    char line[128];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') {
+            continue;
+        }
+        if (replay->moveCount == MAX_MOVES) {
+            printf("Only the first %d moves of the game are loaded.\n", MAX_MOVES);
+            break;
+        }
+        if (replay->moveCount % REPLAY_KEYFRAME_INTERVAL == 0) {
+            TakeSnapshot(&replay->board, replay->sideToMove, &replay->keyframes[replay->moveCount / REPLAY_KEYFRAME_INTERVAL]);
+        }
+
+        // The move must be one of the legal moves, that also gives us its castling and promotion flags
+        int startX, startY, endX, endY;
+        Move moves[MAX_LEGAL_MOVES];
+        int count = GenerateLegalMoves(&replay->board, replay->sideToMove, moves);
+        int found = -1;
+        if (strlen(line) >= 5) {
+            ConvertAlgebraicToIndices(&line[0], &startX, &startY);
+            ConvertAlgebraicToIndices(&line[3], &endX, &endY);
+            for (int i = 0; i < count && found < 0; i++) {
+                if (moves[i].startX == startX && moves[i].startY == startY && moves[i].endX == endX && moves[i].endY == endY) {
+                    found = i;
+                }
+            }
+        }
+        if (found < 0) {
+            printf("Illegal move \"%s\" on line %d of %s.\n", line, lineNumber, fileName);
+            fclose(file);
+            FreeBoard(&replay->board);
+            return false;
+        }
+
+        Move *move = &replay->moves[replay->moveCount++];
+        *move = moves[found];
+        snprintf(move->move, sizeof(move->move), "%.5s", line);
+
+        MoveUndo undo;
+        MakeMove(&replay->board, move, &undo);
+        free(undo.captured);
+        replay->sideToMove = OpponentColor(replay->sideToMove);
+    }
+    fclose(file);
+
+    if (replay->moveCount % REPLAY_KEYFRAME_INTERVAL == 0) {
+        TakeSnapshot(&replay->board, replay->sideToMove, &replay->keyframes[replay->moveCount / REPLAY_KEYFRAME_INTERVAL]);
+    }
+    replay->ply = replay->moveCount;
+    return true;
+}
+
+bool SeekReplay(GameReplay *replay, int ply) {
+    if (ply < 0 || ply > replay->moveCount) {
+        return false;
+    }
+
+    // Start from the keyframe at or before the ply, then play at most REPLAY_KEYFRAME_INTERVAL - 1 moves
+    int keyframe = ply / REPLAY_KEYFRAME_INTERVAL;
+    FreeBoard(&replay->board);
+    RestoreSnapshot(&replay->keyframes[keyframe], &replay->board, &replay->sideToMove);
+    replay->ply = keyframe * REPLAY_KEYFRAME_INTERVAL;
+    StepReplay(replay, ply - replay->ply);
+    return true;
+}
+
+void StepReplay(GameReplay *replay, int plies) {
+    int target = max(0, min(replay->ply + plies, replay->moveCount));
+
+    // Going back or far ahead is cheaper from a keyframe
+    if (target < replay->ply || target - replay->ply >= REPLAY_KEYFRAME_INTERVAL) {
+        SeekReplay(replay, target);
+        return;
+    }
+
+    while (replay->ply < target) {
+        MoveUndo undo;
+        MakeMove(&replay->board, &replay->moves[replay->ply++], &undo);
+        free(undo.captured);
+        replay->sideToMove = OpponentColor(replay->sideToMove);
+    }
+}
+
+void FreeReplay(GameReplay *replay) {
+    FreeBoard(&replay->board);
+}
+
+int RunReplay(const char *fileName) {
+    GameReplay *replay = (GameReplay*)malloc(sizeof(GameReplay));
+    if (replay == NULL || !uploadGame(fileName, replay)) {
+        free(replay);
+        return 1;
+    }
+    SeekReplay(replay, 0);
+
+    char command = ' ';
+    while (command != 'q') {
+        // PrintBoard shows the moves of a game, so show the replay as a game stopped at this ply
+        Player player1, player2;
+        Game game;
+        InitializePlayers(&player1, &player2);
+        game.board = &replay->board;
+        game.players[0] = &player1;
+        game.players[1] = &player2;
+        game.currentPlayer = (replay->sideToMove == 'W') ? 0 : 1;
+        game.moveCount = replay->ply;
+        memcpy(game.moveHistory, replay->moves, replay->ply * sizeof(Move));
+        PrintBoard(&replay->board, &game);
+
+        printf("\nPly %d of %d. n = next, p = previous, f = forward %d, b = back %d, g N = go to ply N, q = quit: ",
+               replay->ply, replay->moveCount, REPLAY_KEYFRAME_INTERVAL, REPLAY_KEYFRAME_INTERVAL);
+        if (scanf(" %c", &command) != 1) {
+            break;
+        }
+
+        int ply;
+        switch (tolower(command)) {
+            case 'n':
+                StepReplay(replay, 1);
+                break;
+            case 'p':
+                StepReplay(replay, -1);
+                break;
+            case 'f':
+                StepReplay(replay, REPLAY_KEYFRAME_INTERVAL);
+                break;
+            case 'b':
+                StepReplay(replay, -REPLAY_KEYFRAME_INTERVAL);
+                break;
+            case 'g':
+                if (scanf("%d", &ply) == 1 && !SeekReplay(replay, ply)) {
+                    printf("The game has only %d plies.\n", replay->moveCount);
+                }
+                break;
+        }
+    }
+
+    FreeReplay(replay);
+    free(replay);
+    return 0;
+}
+
+//##########################-----END OF REPLAY FUNCTIONS---------############################
+
+
+
+//##########################-----FEN TOOL FUNCTIONS---------############################
+
+void AnalyseFenLine(FenLine *line) {
+    static const char *statusNames[] = {"normal", "check", "checkmate", "stalemate"};
+    Board board;
+    FenState state;
+
+    ClearBoard(&board);
+    line->error = NULL;
+    if (line->isTooLong) {
+        line->error = "line too long";
+    } else if (!ParseFEN(&board, line->fen, &state)) {
+        line->error = "not a FEN string";
+    } else {
+        line->error = ValidatePosition(&board, &state);
+    }
+
+    if (line->error != NULL) {
+        snprintf(line->output, sizeof(line->output), "%.100s;invalid;%s", line->fen, line->error);
+        FreeBoard(&board);
+        return;
+    }
+
+    Move moves[MAX_LEGAL_MOVES];
+    bool inCheck = IsKingInCheck(&board, state.sideToMove);
+    int count = GenerateLegalMoves(&board, state.sideToMove, moves);
+    line->legalMoveCount = count + CountEnPassantMoves(&board, &state);
+    for (int i = 0; i < count; i++) {
+        line->legalMoveCount += moves[i].isPromotion ? 3 : 0; // The game always takes a queen, a FEN count has all four pieces
+    }
+    if (line->legalMoveCount == 0) {
+        line->status = inCheck ? POSITION_CHECKMATE : POSITION_STALEMATE;
+    } else {
+        line->status = inCheck ? POSITION_CHECK : POSITION_NORMAL;
+    }
+
+    // Print the position as we wrote it back, so the output is a clean data set
+    char fen[100];
+    WriteFEN(&board, &state, fen, sizeof(fen));
+    snprintf(line->output, sizeof(line->output), "%s;%d;%s", fen, line->legalMoveCount, statusNames[line->status]);
+    FreeBoard(&board);
+}
+
+typedef struct // struct shared by the threads of the bulk FEN tool, for one batch of lines
+{
+    FenLine *lines;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+} FenBatch;
+
+static void* FenWorker(void *argument) {
+    FenBatch *batch = (FenBatch*)argument;
+
+    while (true) {
+        // Take lines in small groups so the lock is rarely touched
+        pthread_mutex_lock(&batch->lock);
+        int first = batch->next;
+        batch->next += 64;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (first >= batch->count) {
+            break;
+        }
+        for (int i = first; i < min(first + 64, batch->count); i++) {
+            AnalyseFenLine(&batch->lines[i]);
+        }
+    }
+    return NULL;
+}
+
+int RunFenStats(const char *fileName, int threadCount) {
+    FILE *file = (strcmp(fileName, "-") == 0) ? stdin : fopen(fileName, "r");
+    if (file == NULL) {
+        printf("Error opening FEN file %s.\n", fileName);
+        return 1;
+    }
+
+    FenBatch batch;
+    batch.lines = (FenLine*)malloc(FEN_BATCH_LINES * sizeof(FenLine));
+    pthread_mutex_init(&batch.lock, NULL);
+    threadCount = max(1, threadCount);
+    pthread_t *threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+
+    unsigned long long total = 0, invalid = 0, totalMoves = 0;
+    unsigned long long statusCounts[4] = {0, 0, 0, 0};
+    int maxMoves = 0;
+    time_t startTime = time(NULL);
+    bool isEnd = false;
+
+    // Read a batch, let every thread work on it, then print it in the order it was read
+    while (!isEnd) {
+        batch.count = 0;
+        batch.next = 0;
+        while (batch.count < FEN_BATCH_LINES) {
+            char *fen = batch.lines[batch.count].fen;
+            if (fgets(fen, sizeof(batch.lines[0].fen), file) == NULL) {
+                isEnd = true;
+                break;
+            }
+            batch.lines[batch.count].isTooLong = false;
+            if (strchr(fen, '\n') == NULL && !feof(file)) {
+                int c;
+                while ((c = fgetc(file)) != '\n' && c != EOF); // Drop the rest of a line that is too long
+                batch.lines[batch.count].isTooLong = true;
+            }
+            fen[strcspn(fen, "\r\n")] = '\0';
+            if (fen[0] != '\0') {
+                batch.count++;
+            }
+        }
+
+        for (int i = 0; i < threadCount; i++) {
+            pthread_create(&threads[i], NULL, FenWorker, &batch);
+        }
+        for (int i = 0; i < threadCount; i++) {
+            pthread_join(threads[i], NULL);
+        }
+
+        for (int i = 0; i < batch.count; i++) {
+            FenLine *line = &batch.lines[i];
+            puts(line->output);
+            total++;
+            if (line->error != NULL) {
+                invalid++;
+                continue;
+            }
+            statusCounts[line->status]++;
+            totalMoves += line->legalMoveCount;
+            maxMoves = max(maxMoves, line->legalMoveCount);
+        }
+    }
+
+    if (file != stdin) {
+        fclose(file);
+    }
+    free(threads);
+    free(batch.lines);
+    pthread_mutex_destroy(&batch.lock);
+
+    // The statistics go to stderr so stdout stays a clean data set
+    unsigned long long valid = total - invalid;
+    fprintf(stderr, "\n%llu positions, %llu invalid, %llu normal, %llu check, %llu checkmate, %llu stalemate\n",
+            total, invalid, statusCounts[POSITION_NORMAL], statusCounts[POSITION_CHECK],
+            statusCounts[POSITION_CHECKMATE], statusCounts[POSITION_STALEMATE]);
+    fprintf(stderr, "Legal moves: %.2f on average, %d at most. %d threads, %.0f seconds\n",
+            valid > 0 ? (double)totalMoves / valid : 0.0, maxMoves, threadCount, difftime(time(NULL), startTime));
+    return 0;
+}
+
+//##########################-----END OF FEN TOOL FUNCTIONS---------############################
+
+
+
+//##########################-----ENGINE FUNCTIONS---------############################
+
+void SetDefaultEngineConfig(EngineConfig *config) {
+    const int values[6] = {tunedMaterial[0], tunedMaterial[1], tunedMaterial[2], tunedMaterial[3], tunedMaterial[4], 0};
+    snprintf(config->name, sizeof(config->name), "default");
+    config->depth = 2;
+    memcpy(config->pieceValues, values, sizeof(values));
+    config->timeSeconds = 60;
+}
+
+bool ParseEngineConfig(const char *spec, EngineConfig *config) {
+    const char *names[] = {"pawn", "knight", "bishop", "rook", "queen"};
+    char copy[256];
+
+    SetDefaultEngineConfig(config);
+    snprintf(config->name, sizeof(config->name), "%s", spec);
+    snprintf(copy, sizeof(copy), "%s", spec);
+
+    for (char *setting = strtok(copy, ","); setting != NULL; setting = strtok(NULL, ",")) {
+        char *equals = strchr(setting, '=');
+        if (equals == NULL) {
+            printf("Engine setting \"%s\" is not in the name=value format.\n", setting);
+            return false;
+        }
+        *equals = '\0';
+        int value = atoi(equals + 1);
+        bool isKnown = false;
+
+        if (strcmp(setting, "depth") == 0) {
+            config->depth = max(1, min(value, 8));
+            isKnown = true;
+        } else if (strcmp(setting, "time") == 0) {
+            config->timeSeconds = max(1, value);
+            isKnown = true;
+        }
+        for (int i = 0; i < 5; i++) {
+            if (strcmp(setting, names[i]) == 0) {
+                config->pieceValues[i] = value;
+                isKnown = true;
+            }
+        }
+        if (!isKnown) {
+            printf("Unknown engine setting \"%s\".\n", setting);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Which parts of eval_tables.h have weights, the evaluation skips the work for the others
+static bool evalUsesPieceSquares = true; // until InitEvaluation runs everything is evaluated
+static bool evalUsesMobility = true;     // mobility and king safety, both need the attack scan
+
+void InitEvaluation(void) {
+    evalUsesPieceSquares = false;
+    for (int i = 0; i < 6 * 64; i++) {
+        evalUsesPieceSquares |= tunedPieceSquare[i / 64][i % 64] != 0;
+    }
+    evalUsesMobility = tunedKingShield != 0 || tunedKingAttack != 0;
+    for (int i = 0; i < 4; i++) {
+        evalUsesMobility |= tunedMobility[i] != 0;
+    }
+}
+
+// Material comes from the engine settings, everything else from eval_tables.h (see RunTuner)
+int EvaluatePosition(Board *board, char sideToMove, const EngineConfig *config) {
+    EvalFeatures features;
+    int score = 0;
+
+    if (!evalUsesPieceSquares && !evalUsesMobility) {
+        for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++) {
+            Piece *piece = board->board[square / BOARD_SIZE][square % BOARD_SIZE];
+            if (piece != NULL) {
+                int value = config->pieceValues[(piece->code & 7) - 1];
+                score += (piece->code & 8) ? -value : value;
+            }
+        }
+        return (sideToMove == 'W') ? score : -score;
+    }
+
+    ExtractEvalFeatures(board, &features, evalUsesMobility);
+    for (int i = 0; i < 5; i++) {
+        score += config->pieceValues[i] * features.terms[EVAL_MATERIAL + i];
+    }
+    for (int i = 0; i < 4; i++) {
+        score += tunedMobility[i] * features.terms[EVAL_MOBILITY + i];
+    }
+    score += tunedKingShield * features.terms[EVAL_KING_SHIELD] + tunedKingAttack * features.terms[EVAL_KING_ATTACK];
+    for (int i = 0; i < features.pieceCount; i++) {
+        int index = features.pieceSquares[i] & ~EVAL_BLACK_PIECE;
+        int value = tunedPieceSquare[index / 64][index % 64];
+        score += (features.pieceSquares[i] & EVAL_BLACK_PIECE) ? -value : value;
+    }
+    return (sideToMove == 'W') ? score : -score;
+}
+
+// Negamax with alpha-beta, captures are searched first
+static int SearchPosition(Board *board, char sideToMove, int depth, int alpha, int beta, int ply,
+                          const EngineConfig *config, unsigned long long *nodes) {
+    (*nodes)++;
+    if (depth == 0) {
+        return EvaluatePosition(board, sideToMove, config);
+    }
+
+    Move moves[MAX_LEGAL_MOVES];
+    int count = GenerateLegalMoves(board, sideToMove, moves);
+    if (count == 0) {
+        return IsKingInCheck(board, sideToMove) ? -(MATE_SCORE - ply) : 0;
+    }
+
+    int captures = 0;
+    for (int i = 0; i < count; i++) {
+        if (moves[i].pieceCaptured != 0) {
+            Move swap = moves[captures];
+            moves[captures++] = moves[i];
+            moves[i] = swap;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        MoveUndo undo;
+        MakeMove(board, &moves[i], &undo);
+        int score = -SearchPosition(board, OpponentColor(sideToMove), depth - 1, -beta, -alpha, ply + 1, config, nodes);
+        UnmakeMove(board, &moves[i], &undo);
+
+        if (score >= beta) {
+            return score;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+    }
+    return alpha;
+}
+
+bool ChooseMove(Board *board, char sideToMove, const EngineConfig *config, uint64_t *seed, Move *best) {
+    Move moves[MAX_LEGAL_MOVES];
+    int count = GenerateLegalMoves(board, sideToMove, moves);
+    if (count == 0) {
+        return false;
+    }
+
+    // Shuffle the moves, so the first of several moves with the same score is a random one
+    for (int i = count - 1; i > 0; i--) {
+        int j = (int)(NextRandom(seed) % (uint64_t)(i + 1));
+        Move swap = moves[i];
+        moves[i] = moves[j];
+        moves[j] = swap;
+    }
+
+    int alpha = -MATE_SCORE - 1;
+    unsigned long long nodes = 0;
+    for (int i = 0; i < count; i++) {
+        MoveUndo undo;
+        MakeMove(board, &moves[i], &undo);
+        int score = -SearchPosition(board, OpponentColor(sideToMove), config->depth - 1, -MATE_SCORE - 1, -alpha, 1, config, &nodes);
+        UnmakeMove(board, &moves[i], &undo);
+
+        if (score > alpha) {
+            alpha = score;
+            *best = moves[i];
+        }
+    }
+    return true;
+}
+
+void PlayEngineGame(EngineGame *game) {
+    Board board;
+    FenState state;
+    Player clocks[2];
+    uint64_t keys[TOURNAMENT_MAX_PLIES + 1];
+    int halfmoveClock = 0;
+
+    ClearBoard(&board);
+    ParseFEN(&board, game->openingFen, &state);
+    char sideToMove = state.sideToMove;
+
+    // Every game has its own clocks
+    InitializePlayers(&clocks[0], &clocks[1]);
+    clocks[0].timeLeft = game->engines[0]->timeSeconds;
+    clocks[1].timeLeft = game->engines[1]->timeSeconds;
+
+    game->result = 0;
+    keys[0] = HashBoard(&board, sideToMove);
+    if (liveBroadcast != NULL) {
+        PublishPosition(liveBroadcast, game->id, &board, sideToMove, NULL, 0, POSITION_NORMAL, &clocks[0], &clocks[1]);
+    }
+    for (game->plies = 0; game->plies < TOURNAMENT_MAX_PLIES; game->plies++) {
+        int index = (sideToMove == 'W') ? 0 : 1;
+        Player *clock = &clocks[index];
+        Move move;
+
+        clock->startTime = time(NULL);
+        if (!ChooseMove(&board, sideToMove, game->engines[index], &game->seed, &move)) {
+            // Checkmate or stalemate
+            game->result = !IsKingInCheck(&board, sideToMove) ? 0 : (sideToMove == 'W') ? -1 : 1;
+            if (liveBroadcast != NULL) {
+                PublishPosition(liveBroadcast, game->id, &board, sideToMove, NULL, game->plies,
+                                game->result == 0 ? POSITION_STALEMATE : POSITION_CHECKMATE, &clocks[0], &clocks[1]);
+            }
+            break;
+        }
+        UpdateTimeLeft(clock);
+        if (clock->isLost) {
+            game->result = (sideToMove == 'W') ? -1 : 1;
+            break;
+        }
+        if (game->recordPosition != NULL) {
+            game->recordPosition(game->context, &board, sideToMove, &move, game->plies);
+        }
+
+        MoveUndo undo;
+        MakeMove(&board, &move, &undo);
+        halfmoveClock = (undo.captured != NULL || toupper(move.pieceMoved) == 'P') ? 0 : halfmoveClock + 1;
+        free(undo.captured);
+        sideToMove = OpponentColor(sideToMove);
+        if (liveBroadcast != NULL) {
+            PublishPosition(liveBroadcast, game->id, &board, sideToMove, &move, game->plies + 1,
+                            IsKingInCheck(&board, sideToMove) ? POSITION_CHECK : POSITION_NORMAL, &clocks[0], &clocks[1]);
+        }
+
+        // Draws: threefold repetition, the fifty move rule and two bare kings
+        uint64_t key = HashBoard(&board, sideToMove);
+        int repetitions = 1;
+        for (int i = game->plies + 1 - 2; i >= max(0, game->plies + 1 - halfmoveClock); i -= 2) {
+            repetitions += (keys[i] == key);
+        }
+        keys[game->plies + 1] = key;
+
+        int pieces = 0;
+        for (int i = 0; i < BOARD_SIZE * BOARD_SIZE; i++) {
+            pieces += board.board[i / BOARD_SIZE][i % BOARD_SIZE] != NULL;
+        }
+        if (repetitions >= 3 || halfmoveClock >= 100 || pieces == 2) {
+            game->plies++;
+            break;
+        }
+    }
+
+    FreeBoard(&board);
+}
+
+//##########################-----END OF ENGINE FUNCTIONS---------############################
+
+
+
+//##########################-----TOURNAMENT FUNCTIONS---------############################
+
+// Balanced start positions, every one is played twice with the colors swapped
+static const char *tournamentOpenings[] = {
+    "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+    "rnbqkbnr/pppppppp/8/8/3P4/8/PPP1PPPP/RNBQKBNR b KQkq - 0 1",
+    "rnbqkbnr/pppppppp/8/8/2P5/8/PP1PPPPP/RNBQKBNR b KQkq - 0 1",
+    "rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1",
+    "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/ppp1pppp/8/3p4/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 1 2",
+    "rnbqkbnr/pppp1ppp/4p3/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pp1ppppp/2p5/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pppppp1p/6p1/8/8/5N2/PPPPPPPP/RNBQKB1R w KQkq - 0 2",
+    "rnbqkbnr/ppppp1pp/8/5p2/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 0 2"
+};
+
+typedef struct // struct shared by the threads of a tournament
+{
+    EngineConfig engines[2]; // engine A and engine B
+    int gameCount;
+    int nextGame;
+    int wins, draws, losses; // from engine A
+    bool isDecided;          // SPRT accepted one of the hypotheses
+    pthread_mutex_t lock;
+} Tournament;
+
+static double EloFromScore(double score) {
+    score = fmin(fmax(score, 0.001), 0.999);
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+static double ScoreFromElo(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+// Print the running statistics and decide the SPRT, called with the lock held
+static void UpdateTournament(Tournament *tournament) {
+    int games = tournament->wins + tournament->draws + tournament->losses;
+
+    // With a result that never happened the variance would be 0 and nothing could be decided,
+    // so give every result half a game in that case
+    double smoothing = (tournament->wins == 0 || tournament->draws == 0 || tournament->losses == 0) ? 0.5 : 0.0;
+    double wins = tournament->wins + smoothing;
+    double draws = tournament->draws + smoothing;
+    double losses = tournament->losses + smoothing;
+    double total = wins + draws + losses;
+    double score = (wins + 0.5 * draws) / total;
+
+    // Variance of the score of one game, from the win, draw and loss frequencies
+    double variance = (wins * pow(1.0 - score, 2) + draws * pow(0.5 - score, 2) + losses * pow(score, 2)) / total;
+    double margin = 1.96 * sqrt(variance / total);
+    double elo = EloFromScore(score);
+    double errorBar = (EloFromScore(score + margin) - EloFromScore(score - margin)) / 2.0;
+
+    // Log likelihood ratio of the two hypotheses, with the normal approximation of the score
+    double score0 = ScoreFromElo(SPRT_ELO0);
+    double score1 = ScoreFromElo(SPRT_ELO1);
+    double llr = (variance > 0.0) ? (score1 - score0) * (2.0 * score - score0 - score1) * total / (2.0 * variance) : 0.0;
+    double lower = log(SPRT_BETA / (1.0 - SPRT_ALPHA));
+    double upper = log((1.0 - SPRT_BETA) / SPRT_ALPHA);
+
+    printf("Games %d: +%d -%d =%d, Elo %.1f +/- %.1f, LLR %.2f [%.2f, %.2f]\n",
+           games, tournament->wins, tournament->losses, tournament->draws, elo, errorBar, llr, lower, upper);
+
+    if (!tournament->isDecided && (llr >= upper || llr <= lower)) {
+        tournament->isDecided = true;
+        printf("SPRT: %s (elo0 %.0f, elo1 %.0f).\n",
+               (llr >= upper) ? "H1 accepted, engine A is stronger" : "H0 accepted, engine A is not stronger", SPRT_ELO0, SPRT_ELO1);
+    }
+}
+
+static void* TournamentWorker(void *argument) {
+    Tournament *tournament = (Tournament*)argument;
+    int openingCount = sizeof(tournamentOpenings) / sizeof(tournamentOpenings[0]);
+
+    while (true) {
+        pthread_mutex_lock(&tournament->lock);
+        int index = tournament->nextGame++;
+        bool isDone = tournament->isDecided || index >= tournament->gameCount;
+        pthread_mutex_unlock(&tournament->lock);
+        if (isDone) {
+            break;
+        }
+
+        // Engine A plays white in the even games
+        EngineGame game;
+        bool isAWhite = (index % 2 == 0);
+        game.engines[0] = &tournament->engines[isAWhite ? 0 : 1];
+        game.engines[1] = &tournament->engines[isAWhite ? 1 : 0];
+        game.openingFen = tournamentOpenings[(index / 2) % openingCount];
+        game.seed = 0x5EED0000ULL + (uint64_t)index;
+        game.id = (uint32_t)index + 1;
+        game.recordPosition = NULL;
+        PlayEngineGame(&game);
+
+        int resultForA = isAWhite ? game.result : -game.result;
+        pthread_mutex_lock(&tournament->lock);
+        tournament->wins += (resultForA > 0);
+        tournament->draws += (resultForA == 0);
+        tournament->losses += (resultForA < 0);
+        UpdateTournament(tournament);
+        pthread_mutex_unlock(&tournament->lock);
+    }
+    return NULL;
+}
+
+int RunTournament(const char *specA, const char *specB, int gameCount, int threadCount) {
+    Tournament tournament = {0};
+    if (!ParseEngineConfig(specA, &tournament.engines[0]) || !ParseEngineConfig(specB, &tournament.engines[1])) {
+        return 1;
+    }
+    tournament.gameCount = max(1, gameCount);
+    threadCount = max(1, min(threadCount, tournament.gameCount));
+    pthread_mutex_init(&tournament.lock, NULL);
+
+    printf("Engine A: %s\nEngine B: %s\n%d games on %d threads\n\n",
+           tournament.engines[0].name, tournament.engines[1].name, tournament.gameCount, threadCount);
+
+    pthread_t *threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+    for (int i = 0; i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, TournamentWorker, &tournament);
+    }
+    for (int i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&tournament.lock);
+
+    if (!tournament.isDecided) {
+        printf("SPRT: no decision after %d games.\n", tournament.wins + tournament.draws + tournament.losses);
+    }
+    return 0;
+}
+
+//##########################-----END OF TOURNAMENT FUNCTIONS---------############################
+
+
+
+//##########################-----TRAINING DATA FUNCTIONS---------############################
+
+uint16_t PackMove(const Move *move) {
+    return (uint16_t)((move->startX * BOARD_SIZE + move->startY) | ((move->endX * BOARD_SIZE + move->endY) << 6) |
+                      (move->isPromotion ? PieceCodeFromType('Q', 'W') << 12 : 0)); // the game always promotes to a queen
+}
+
+void PackPosition(Board *board, char sideToMove, const Move *move, PackedPosition *packed) {
+    int count = 0;
+
+    memset(packed, 0, sizeof(PackedPosition));
+    for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++) {
+        Piece *piece = board->board[square / BOARD_SIZE][square % BOARD_SIZE];
+        if (piece != NULL && count < 32) {
+            packed->occupancy |= 1ULL << square;
+            packed->pieces[count / 2] |= piece->code << (4 * (count % 2));
+            count++;
+        }
+    }
+    packed->flags = (sideToMove == 'B' ? 1 : 0) | (CastlingRights(board) << 1);
+    packed->move = PackMove(move);
+}
+
+void WritePackedPosition(const PackedPosition *packed, uint8_t *out) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(packed->occupancy >> (8 * i));
+    }
+    memcpy(&out[8], packed->pieces, 16);
+    out[24] = packed->flags;
+    out[25] = (uint8_t)packed->result;
+    out[26] = (uint8_t)packed->move;
+    out[27] = (uint8_t)(packed->move >> 8);
+    out[28] = (uint8_t)(uint16_t)packed->score;
+    out[29] = (uint8_t)((uint16_t)packed->score >> 8);
+    out[30] = (uint8_t)packed->ply;
+    out[31] = (uint8_t)(packed->ply >> 8);
+}
+
+void ReadPackedPosition(const uint8_t *in, PackedPosition *packed) {
+    packed->occupancy = 0;
+    for (int i = 0; i < 8; i++) {
+        packed->occupancy |= (uint64_t)in[i] << (8 * i);
+    }
+    memcpy(packed->pieces, &in[8], 16);
+    packed->flags = in[24];
+    packed->result = (int8_t)in[25];
+    packed->move = (uint16_t)(in[26] | (in[27] << 8));
+    packed->score = (int16_t)(in[28] | (in[29] << 8));
+    packed->ply = (uint16_t)(in[30] | (in[31] << 8));
+}
+
+bool UnpackPosition(const PackedPosition *packed, Board *board, char *sideToMove) {
+    // A record from a damaged file must not reach CreatePieceFromCode with a code it does not know
+    int pieceCount = __builtin_popcountll(packed->occupancy);
+    if (pieceCount > 32 || packed->result < -1 || packed->result > 1) {
+        return false;
+    }
+    for (int i = 0; i < pieceCount; i++) {
+        int code = (packed->pieces[i / 2] >> (4 * (i % 2))) & 0xF;
+        if ((code & 7) == 0 || (code & 7) == 7) {
+            return false;
+        }
+    }
+
+    int count = 0;
+    for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++) {
+        int x = square / BOARD_SIZE;
+        int y = square % BOARD_SIZE;
+        board->board[x][y] = NULL;
+        if (packed->occupancy & (1ULL << square)) {
+            int code = (packed->pieces[count / 2] >> (4 * (count % 2))) & 0xF;
+            board->board[x][y] = CreatePieceFromCode(x, y, code);
+            count++;
+        }
+    }
+    SetCastlingRights(board, packed->flags >> 1);
+    *sideToMove = (packed->flags & 1) ? 'B' : 'W';
+    return true;
+}
+
+// A ".gz" file goes through gzip, so no compression library is needed
+static FILE* OpenTrainingFile(const char *fileName, bool isWriting, bool *isCompressed) {
+    size_t length = strlen(fileName);
+    *isCompressed = length > 3 && strcmp(fileName + length - 3, ".gz") == 0;
+    if (!*isCompressed) {
+        return fopen(fileName, isWriting ? "wb" : "rb");
+    }
+
+    char command[512];
+    snprintf(command, sizeof(command), isWriting ? "gzip -c > \"%s\"" : "gzip -dc \"%s\"", fileName);
+    #if defined(_WIN32)
+        return _popen(command, isWriting ? "wb" : "rb");
+    #else
+        return popen(command, isWriting ? "w" : "r");
+    #endif
+}
+
+// Returns false when the file could not be completed, for gzip also when gzip failed
+static bool CloseTrainingFile(FILE *file, bool isCompressed) {
+    if (!isCompressed) {
+        return fclose(file) == 0;
+    }
+    #if defined(_WIN32)
+        return _pclose(file) == 0;
+    #else
+        return pclose(file) == 0;
+    #endif
+}
+
+typedef struct // struct shared by the threads of the training data generator
+{
+    EngineConfig engine;
+    FILE *file;
+    int gameCount;
+    int nextGame;
+    unsigned long long positions;
+    int results[3];         // black wins, draws, white wins
+    bool isWriteFailed;     // a write to the file came up short, the file is not complete
+    pthread_mutex_t lock;   // guards the counters
+    pthread_mutex_t fileLock;
+} TrainingRun;
+
+typedef struct // struct for the positions of the game a thread is playing
+{
+    PackedPosition positions[TOURNAMENT_MAX_PLIES];
+    int count;
+    const EngineConfig *engine;
+} TrainingGame;
+
+static void RecordTrainingPosition(void *context, Board *board, char sideToMove, const Move *move, int ply) {
+    TrainingGame *game = (TrainingGame*)context;
+    PackedPosition *packed = &game->positions[game->count++];
+    PackPosition(board, sideToMove, move, packed);
+    packed->score = (int16_t)EvaluatePosition(board, sideToMove, game->engine);
+    packed->ply = (uint16_t)ply;
+}
+
+// Start position plus a few random moves, so no two games are the same
+static bool RandomOpening(uint64_t *seed, char *fen, size_t size) {
+    Board board;
+    FenState state = {'W', 0, -1, -1, 0, 1};
+    bool isPlayable = true;
+
+    ClearBoard(&board);
+    InitializeBoard(&board);
+    for (int ply = 0; ply < TRAINING_RANDOM_PLIES && isPlayable; ply++) {
+        Move moves[MAX_LEGAL_MOVES];
+        int count = GenerateLegalMoves(&board, state.sideToMove, moves);
+        isPlayable = count > 0;
+        if (isPlayable) {
+            MoveUndo undo;
+            MakeMove(&board, &moves[NextRandom(seed) % (uint64_t)count], &undo);
+            free(undo.captured);
+            state.sideToMove = OpponentColor(state.sideToMove);
+        }
+    }
+    state.fullmoveNumber = 1 + TRAINING_RANDOM_PLIES / 2;
+    isPlayable = WriteFEN(&board, &state, fen, size) && isPlayable;
+    FreeBoard(&board);
+    return isPlayable;
+}
+
+static void* TrainingWorker(void *argument) {
+    TrainingRun *run = (TrainingRun*)argument;
+    TrainingGame *game = (TrainingGame*)malloc(sizeof(TrainingGame));
+    uint8_t *buffer = (uint8_t*)malloc(TRAINING_BUFFER_POSITIONS * 32);
+    int buffered = 0;
+    if (game == NULL || buffer == NULL) {
+        // This thread takes no games, the others play them
+        free(game);
+        free(buffer);
+        return NULL;
+    }
+
+    while (true) {
+        pthread_mutex_lock(&run->lock);
+        int index = run->nextGame++;
+        pthread_mutex_unlock(&run->lock);
+        if (index >= run->gameCount) {
+            break;
+        }
+
+        char fen[100];
+        EngineGame engineGame;
+        engineGame.seed = 0x7A11ULL + (uint64_t)index * 0x9E3779B97F4A7C15ULL;
+        if (!RandomOpening(&engineGame.seed, fen, sizeof(fen))) {
+            continue;
+        }
+        engineGame.engines[0] = &run->engine;
+        engineGame.engines[1] = &run->engine;
+        engineGame.openingFen = fen;
+        engineGame.id = (uint32_t)index + 1;
+        engineGame.recordPosition = RecordTrainingPosition;
+        engineGame.context = game;
+        game->count = 0;
+        game->engine = &run->engine;
+        PlayEngineGame(&engineGame);
+
+        // The result is only known now, then the positions go to the buffer of the thread
+        for (int i = 0; i < game->count; i++) {
+            game->positions[i].result = (int8_t)engineGame.result;
+            if (buffered == TRAINING_BUFFER_POSITIONS) {
+                pthread_mutex_lock(&run->fileLock);
+                if (fwrite(buffer, 32, buffered, run->file) != (size_t)buffered) {
+                    run->isWriteFailed = true;
+                }
+                pthread_mutex_unlock(&run->fileLock);
+                buffered = 0;
+            }
+            WritePackedPosition(&game->positions[i], &buffer[32 * buffered++]);
+        }
+
+        pthread_mutex_lock(&run->lock);
+        run->positions += game->count;
+        run->results[engineGame.result + 1]++;
+        pthread_mutex_unlock(&run->lock);
+    }
+
+    pthread_mutex_lock(&run->fileLock);
+    if (fwrite(buffer, 32, buffered, run->file) != (size_t)buffered) {
+        run->isWriteFailed = true;
+    }
+    pthread_mutex_unlock(&run->fileLock);
+    free(buffer);
+    free(game);
+    return NULL;
+}
+
+int RunTrainingGenerator(const char *fileName, int gameCount, int threadCount, const char *engineSpec) {
+    TrainingRun run = {0};
+    if (!ParseEngineConfig(engineSpec, &run.engine)) {
+        return 1;
+    }
+
+    bool isCompressed;
+    run.file = OpenTrainingFile(fileName, true, &isCompressed);
+    if (run.file == NULL) {
+        printf("Error opening %s for writing.\n", fileName);
+        return 1;
+    }
+    setvbuf(run.file, NULL, _IOFBF, 1 << 20);
+
+    run.gameCount = max(0, gameCount);
+    threadCount = max(1, min(threadCount, max(1, run.gameCount)));
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_mutex_init(&run.fileLock, NULL);
+    time_t startTime = time(NULL);
+
+    pthread_t *threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+    if (threads == NULL) {
+        TrainingWorker(&run); // Play the games on this thread
+    }
+    for (int i = 0; threads != NULL && i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, TrainingWorker, &run);
+    }
+    for (int i = 0; threads != NULL && i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&run.lock);
+    pthread_mutex_destroy(&run.fileLock);
+
+    if (!CloseTrainingFile(run.file, isCompressed) || run.isWriteFailed) {
+        printf("Error writing %s, the file is not complete.\n", fileName);
+        return 1;
+    }
+    if (run.nextGame < run.gameCount) {
+        printf("Not enough memory to play %d of %d games, %s is not complete.\n",
+               run.gameCount - run.nextGame, run.gameCount, fileName);
+        return 1;
+    }
+
+    printf("%llu positions from %d games (white %d, draws %d, black %d) written to %s in %.0f seconds\n",
+           run.positions, run.results[0] + run.results[1] + run.results[2], run.results[2], run.results[1],
+           run.results[0], fileName, difftime(time(NULL), startTime));
+    return 0;
+}
+
+int RunTrainingDump(const char *fileName, int count) {
+    bool isCompressed;
+    FILE *file = OpenTrainingFile(fileName, false, &isCompressed);
+    if (file == NULL) {
+        printf("Error opening %s for reading.\n", fileName);
+        return 1;
+    }
+
+    uint8_t bytes[32];
+    for (int i = 0; i < count && fread(bytes, 32, 1, file) == 1; i++) {
+        PackedPosition packed;
+        Board board;
+        FenState state = {'W', 0, -1, -1, 0, 1};
+        char fen[100];
+        char move[8];
+
+        ReadPackedPosition(bytes, &packed);
+        if (!UnpackPosition(&packed, &board, &state.sideToMove)) {
+            printf("Record %d is not a valid position.\n", i);
+            continue;
+        }
+        WriteFEN(&board, &state, fen, sizeof(fen));
+        ConvertIndicesToAlgebraic((packed.move & 63) / BOARD_SIZE, (packed.move & 63) % BOARD_SIZE, move);
+        move[2] = '-';
+        ConvertIndicesToAlgebraic(((packed.move >> 6) & 63) / BOARD_SIZE, ((packed.move >> 6) & 63) % BOARD_SIZE, move + 3);
+        printf("%s;%s;%d;%d;%d\n", fen, move, packed.score, packed.result, packed.ply);
+        FreeBoard(&board);
+    }
+    CloseTrainingFile(file, isCompressed);
+    return 0;
+}
+
+//##########################-----END OF TRAINING DATA FUNCTIONS---------############################
+
+
+
+//##########################-----TUNER FUNCTIONS---------############################
+
+// Knight jumps, then the eight directions: the first four are straight, the last four diagonal
+static const int knightJumps[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+static const int directions[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+void ExtractEvalFeatures(Board *board, EvalFeatures *features, bool withMobility) {
+    uint64_t attacks[2] = {0, 0}; // the squares every side attacks, for the king safety
+    int kingSquare[2] = {-1, -1};
+
+    memset(features, 0, sizeof(EvalFeatures));
+    for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++) {
+        int x = square / BOARD_SIZE;
+        int y = square % BOARD_SIZE;
+        Piece *piece = board->board[x][y];
+        if (piece == NULL) {
+            continue;
+        }
+        int type = piece->code & 7;
+        int side = piece->code >> 3;
+        int sign = side ? -1 : 1;
+        int mobility = 0;
+
+        // The tables are from white's side, a black piece uses the mirrored square
+        if (features->pieceCount < 32) {
+            int ownSquare = side ? (7 - x) * BOARD_SIZE + y : square;
+            features->pieceSquares[features->pieceCount++] = (uint16_t)(((type - 1) * 64 + ownSquare) | (side ? EVAL_BLACK_PIECE : 0));
+        }
+        if (type <= 5) {
+            features->terms[EVAL_MATERIAL + type - 1] += sign;
+        }
+        if (!withMobility) {
+            continue;
+        }
+
+        if (type == 1) {
+            int forward = side ? -1 : 1;
+            for (int dy = -1; dy <= 1; dy += 2) {
+                if (x + forward >= 0 && x + forward < BOARD_SIZE && y + dy >= 0 && y + dy < BOARD_SIZE) {
+                    attacks[side] |= 1ULL << ((x + forward) * BOARD_SIZE + y + dy);
+                }
+            }
+        } else if (type == 2 || type == 6) {
+            for (int i = 0; i < 8; i++) {
+                int targetX = x + (type == 2 ? knightJumps[i][0] : directions[i][0]);
+                int targetY = y + (type == 2 ? knightJumps[i][1] : directions[i][1]);
+                if (targetX >= 0 && targetX < BOARD_SIZE && targetY >= 0 && targetY < BOARD_SIZE) {
+                    Piece *target = board->board[targetX][targetY];
+                    attacks[side] |= 1ULL << (targetX * BOARD_SIZE + targetY);
+                    mobility += (target == NULL || target->color != piece->color);
+                }
+            }
+        } else {
+            // Bishops use the diagonal directions, rooks the straight ones and queens all of them
+            int first = (type == 3) ? 4 : 0;
+            int last = (type == 4) ? 4 : 8;
+            for (int i = first; i < last; i++) {
+                int targetX = x + directions[i][0];
+                int targetY = y + directions[i][1];
+                while (targetX >= 0 && targetX < BOARD_SIZE && targetY >= 0 && targetY < BOARD_SIZE) {
+                    Piece *target = board->board[targetX][targetY];
+                    attacks[side] |= 1ULL << (targetX * BOARD_SIZE + targetY);
+                    if (target != NULL) {
+                        mobility += (target->color != piece->color);
+                        break;
+                    }
+                    mobility++;
+                    targetX += directions[i][0];
+                    targetY += directions[i][1];
+                }
+            }
+        }
+
+        if (type >= 2 && type <= 5) {
+            features->terms[EVAL_MOBILITY + type - 2] += sign * mobility;
+        }
+        if (type == 6) {
+            kingSquare[side] = square;
+        }
+    }
+
+    for (int side = 0; side < 2; side++) {
+        if (kingSquare[side] < 0) {
+            continue;
+        }
+        int kingX = kingSquare[side] / BOARD_SIZE;
+        int kingY = kingSquare[side] % BOARD_SIZE;
+        int forward = side ? -1 : 1;
+        int shield = 0;
+        int attacked = 0;
+
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                int x = kingX + dx;
+                int y = kingY + dy;
+                if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE) {
+                    continue;
+                }
+                Piece *piece = board->board[x][y];
+                shield += (dx == forward && piece != NULL && piece->code == (side ? 9 : 1));
+                attacked += (attacks[1 - side] >> (x * BOARD_SIZE + y)) & 1;
+            }
+        }
+        features->terms[EVAL_KING_SHIELD] += side ? -shield : shield;
+        features->terms[EVAL_KING_ATTACK] += side ? -attacked : attacked;
+    }
+}
+
+typedef struct // struct for the part of the tuner data one thread works on
+{
+    TunerData *data;
+    const float *weights;
+    const uint8_t *bytes; // packed positions, only while loading
+    int begin, end;       // positions, multiples of TUNER_BLOCK except the end of the data
+    double loss;
+    double *gradient;
+    bool isThreaded;      // false when no thread could be started and the caller did the work
+} TunerSlice;
+
+static void* ExtractTunerSlice(void *argument) {
+    TunerSlice *slice = (TunerSlice*)argument;
+    TunerData *data = slice->data;
+
+    for (int i = slice->begin; i < slice->end; i++) {
+        PackedPosition packed;
+        EvalFeatures features;
+        Board board;
+        char sideToMove;
+
+        ReadPackedPosition(&slice->bytes[(size_t)i * 32], &packed);
+        if (!UnpackPosition(&packed, &board, &sideToMove)) {
+            // No features and a draw: a score of 0 predicts it exactly, so it adds no error or gradient
+            data->results[i] = 0.5f;
+            continue;
+        }
+        ExtractEvalFeatures(&board, &features, true);
+        FreeBoard(&board);
+
+        for (int f = 0; f < EVAL_TERMS; f++) {
+            data->terms[f][i] = features.terms[f];
+        }
+        memcpy(&data->pieceSquares[(size_t)i * 32], features.pieceSquares, features.pieceCount * sizeof(uint16_t));
+        data->pieceCounts[i] = (uint8_t)features.pieceCount;
+        data->results[i] = (packed.result + 1) * 0.5f;
+    }
+    return NULL;
+}
+
+static void SplitTunerWork(TunerSlice *slices, int threadCount, int count) {
+    int blocks = (count + TUNER_BLOCK - 1) / TUNER_BLOCK;
+    for (int i = 0; i < threadCount; i++) {
+        slices[i].begin = min(count, (int)((long long)blocks * i / threadCount) * TUNER_BLOCK);
+        slices[i].end = min(count, (int)((long long)blocks * (i + 1) / threadCount) * TUNER_BLOCK);
+    }
+}
+
+bool LoadTunerData(const char *fileName, int threadCount, TunerData *data) {
+    memset(data, 0, sizeof(TunerData));
+    bool isCompressed;
+    FILE *file = OpenTrainingFile(fileName, false, &isCompressed);
+    if (file == NULL) {
+        printf("Error opening %s for reading.\n", fileName);
+        return false;
+    }
+
+    // Read all the packed positions, then extract the features on every thread
+    size_t capacity = TRAINING_BUFFER_POSITIONS * 32;
+    size_t size = 0;
+    uint8_t *bytes = (uint8_t*)malloc(capacity);
+    size_t got;
+    while (bytes != NULL && (got = fread(&bytes[size], 1, capacity - size, file)) > 0) {
+        size += got;
+        if (size == capacity) {
+            uint8_t *grown = (uint8_t*)realloc(bytes, capacity * 2);
+            if (grown == NULL) {
+                free(bytes);
+            }
+            bytes = grown;
+            capacity *= 2;
+        }
+    }
+    CloseTrainingFile(file, isCompressed);
+    if (bytes == NULL || size / 32 > (size_t)(0x7FFFFFFF - TUNER_BLOCK)) {
+        printf("Not enough memory for the positions of %s.\n", fileName);
+        free(bytes);
+        return false;
+    }
+
+    data->count = (int)(size / 32);
+    size_t padded = ((size_t)data->count + TUNER_BLOCK - 1) / TUNER_BLOCK * TUNER_BLOCK;
+    bool isAllocated = true;
+    for (int f = 0; f < EVAL_TERMS; f++) {
+        data->terms[f] = (float*)calloc(padded, sizeof(float));
+        isAllocated &= data->terms[f] != NULL;
+    }
+    data->pieceSquares = (uint16_t*)malloc(padded * 32 * sizeof(uint16_t));
+    data->pieceCounts = (uint8_t*)calloc(padded, 1);
+    data->results = (float*)calloc(padded, sizeof(float));
+    if (!isAllocated || data->pieceSquares == NULL || data->pieceCounts == NULL || data->results == NULL) {
+        printf("Not enough memory for the features of %d positions.\n", data->count);
+        FreeTunerData(data);
+        free(bytes);
+        return false;
+    }
+
+    TunerSlice *slices = (TunerSlice*)calloc(threadCount, sizeof(TunerSlice));
+    pthread_t *threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+    if (slices == NULL || threads == NULL) {
+        printf("Not enough memory for %d threads.\n", threadCount);
+        free(slices);
+        free(threads);
+        FreeTunerData(data);
+        free(bytes);
+        return false;
+    }
+    SplitTunerWork(slices, threadCount, data->count);
+    for (int i = 0; i < threadCount; i++) {
+        slices[i].data = data;
+        slices[i].bytes = bytes;
+        slices[i].isThreaded = pthread_create(&threads[i], NULL, ExtractTunerSlice, &slices[i]) == 0;
+        if (!slices[i].isThreaded) {
+            ExtractTunerSlice(&slices[i]);
+        }
+    }
+    for (int i = 0; i < threadCount; i++) {
+        if (slices[i].isThreaded) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    free(threads);
+    free(slices);
+    free(bytes);
+    return data->count > 0;
+}
+
+void FreeTunerData(TunerData *data) {
+    for (int f = 0; f < EVAL_TERMS; f++) {
+        free(data->terms[f]);
+    }
+    free(data->pieceSquares);
+    free(data->pieceCounts);
+    free(data->results);
+    memset(data, 0, sizeof(TunerData));
+}
+
+typedef float TunerVector __attribute__((vector_size(16))); // 4 floats, SSE2 and NEON registers hold one
+
+#define TUNER_LANES ((int)(sizeof(TunerVector) / sizeof(float)))
+
+static inline TunerVector LoadTunerVector(const float *source) {
+    TunerVector vector;
+    memcpy(&vector, source, sizeof(vector));
+    return vector;
+}
+
+// The terms are one array each, so a block of positions is scored and differentiated
+// with vector multiply-adds; only the piece-square tables need a gather and a scatter.
+static void* TunerGradientSlice(void *argument) {
+    TunerSlice *slice = (TunerSlice*)argument;
+    const TunerData *data = slice->data;
+    const float *weights = slice->weights;
+    float scores[TUNER_BLOCK];
+    float residuals[TUNER_BLOCK];
+
+    slice->loss = 0;
+    memset(slice->gradient, 0, EVAL_WEIGHTS * sizeof(double));
+    for (int block = slice->begin; block < slice->end; block += TUNER_BLOCK) {
+        int size = min(TUNER_BLOCK, slice->end - block);
+
+        for (int i = 0; i < TUNER_BLOCK; i += TUNER_LANES) {
+            TunerVector score = {0};
+            for (int f = 0; f < EVAL_TERMS; f++) {
+                score += LoadTunerVector(&data->terms[f][block + i]) * weights[f];
+            }
+            memcpy(&scores[i], &score, sizeof(score));
+        }
+        for (int i = 0; i < size; i++) {
+            const uint16_t *pieceSquares = &data->pieceSquares[(size_t)(block + i) * 32];
+            for (int k = 0; k < data->pieceCounts[block + i]; k++) {
+                float value = weights[EVAL_TERMS + (pieceSquares[k] & ~EVAL_BLACK_PIECE)];
+                scores[i] += (pieceSquares[k] & EVAL_BLACK_PIECE) ? -value : value;
+            }
+        }
+
+        // Squared error of the winning chance, the padding past the end has no residual
+        for (int i = 0; i < TUNER_BLOCK; i++) {
+            float chance = 1.0f / (1.0f + expf(-(float)TUNER_SCALE * scores[i]));
+            float error = chance - data->results[block + i];
+            residuals[i] = (i < size) ? 2.0f * error * chance * (1.0f - chance) * (float)TUNER_SCALE : 0.0f;
+            slice->loss += (i < size) ? error * error : 0.0f;
+        }
+
+        for (int f = 0; f < EVAL_TERMS; f++) {
+            TunerVector sum = {0};
+            for (int i = 0; i < TUNER_BLOCK; i += TUNER_LANES) {
+                sum += LoadTunerVector(&data->terms[f][block + i]) * LoadTunerVector(&residuals[i]);
+            }
+            for (int lane = 0; lane < TUNER_LANES; lane++) {
+                slice->gradient[f] += sum[lane];
+            }
+        }
+        for (int i = 0; i < size; i++) {
+            const uint16_t *pieceSquares = &data->pieceSquares[(size_t)(block + i) * 32];
+            for (int k = 0; k < data->pieceCounts[block + i]; k++) {
+                int index = EVAL_TERMS + (pieceSquares[k] & ~EVAL_BLACK_PIECE);
+                slice->gradient[index] += (pieceSquares[k] & EVAL_BLACK_PIECE) ? -residuals[i] : residuals[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+double TunerGradient(const TunerData *data, const float *weights, int threadCount, double *gradient) {
+    TunerSlice *slices = (TunerSlice*)calloc(threadCount, sizeof(TunerSlice));
+    pthread_t *threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+    double loss = 0;
+
+    bool isAllocated = slices != NULL && threads != NULL;
+    for (int i = 0; isAllocated && i < threadCount; i++) {
+        slices[i].gradient = (double*)malloc(EVAL_WEIGHTS * sizeof(double));
+        isAllocated = slices[i].gradient != NULL;
+    }
+    if (!isAllocated) {
+        for (int i = 0; slices != NULL && i < threadCount; i++) {
+            free(slices[i].gradient);
+        }
+        free(threads);
+        free(slices);
+        return -1;
+    }
+
+    SplitTunerWork(slices, threadCount, data->count);
+    for (int i = 0; i < threadCount; i++) {
+        slices[i].data = (TunerData*)data;
+        slices[i].weights = weights;
+        slices[i].isThreaded = pthread_create(&threads[i], NULL, TunerGradientSlice, &slices[i]) == 0;
+        if (!slices[i].isThreaded) {
+            TunerGradientSlice(&slices[i]);
+        }
+    }
+
+    memset(gradient, 0, EVAL_WEIGHTS * sizeof(double));
+    for (int i = 0; i < threadCount; i++) {
+        if (slices[i].isThreaded) {
+            pthread_join(threads[i], NULL);
+        }
+        loss += slices[i].loss;
+        for (int w = 0; w < EVAL_WEIGHTS; w++) {
+            gradient[w] += slices[i].gradient[w] / data->count;
+        }
+        free(slices[i].gradient);
+    }
+    free(threads);
+    free(slices);
+    return loss / data->count;
+}
+
+bool WriteEvalTables(const char *fileName, const float *weights, int positions) {
+    static const char *pieceNames[] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+    FILE *file = fopen(fileName, "w");
+    if (file == NULL) {
+        printf("Error opening %s for writing.\n", fileName);
+        return false;
+    }
+
+    fprintf(file, "// Evaluation weights, generated by \"chess_game --tune\" from %d positions.\n", positions);
+    fprintf(file, "// Run the tuner again rather than editing the numbers by hand.\n\n");
+    fprintf(file, "#ifndef EVAL_TABLES_H_INCLUDED\n#define EVAL_TABLES_H_INCLUDED\n\n");
+    fprintf(file, "// P N B R Q, the default piece values of the engine\n");
+    fprintf(file, "static const int tunedMaterial[5] = {%d, %d, %d, %d, %d};\n\n", (int)lrintf(weights[EVAL_MATERIAL]),
+            (int)lrintf(weights[EVAL_MATERIAL + 1]), (int)lrintf(weights[EVAL_MATERIAL + 2]),
+            (int)lrintf(weights[EVAL_MATERIAL + 3]), (int)lrintf(weights[EVAL_MATERIAL + 4]));
+    fprintf(file, "// N B R Q, for every square the piece can move to\n");
+    fprintf(file, "static const int tunedMobility[4] = {%d, %d, %d, %d};\n\n", (int)lrintf(weights[EVAL_MOBILITY]),
+            (int)lrintf(weights[EVAL_MOBILITY + 1]), (int)lrintf(weights[EVAL_MOBILITY + 2]), (int)lrintf(weights[EVAL_MOBILITY + 3]));
+    fprintf(file, "static const int tunedKingShield = %d; // for every own pawn right in front of the king\n",
+            (int)lrintf(weights[EVAL_KING_SHIELD]));
+    fprintf(file, "static const int tunedKingAttack = %d; // for every square next to the king the opponent attacks\n\n",
+            (int)lrintf(weights[EVAL_KING_ATTACK]));
+    fprintf(file, "// P N B R Q K, square x * 8 + y seen from the side of the piece (the first row is its first rank)\n");
+    fprintf(file, "static const int tunedPieceSquare[6][64] = {\n");
+    for (int type = 0; type < 6; type++) {
+        fprintf(file, "    { // %s\n", pieceNames[type]);
+        for (int x = 0; x < BOARD_SIZE; x++) {
+            fprintf(file, "       ");
+            for (int y = 0; y < BOARD_SIZE; y++) {
+                bool isLast = (x == BOARD_SIZE - 1 && y == BOARD_SIZE - 1);
+                fprintf(file, " %4d%s", (int)lrintf(weights[EVAL_TERMS + type * 64 + x * BOARD_SIZE + y]), isLast ? "" : ",");
+            }
+            fprintf(file, "\n");
+        }
+        fprintf(file, "    }%s\n", (type == 5) ? "" : ",");
+    }
+    fprintf(file, "};\n\n#endif // EVAL_TABLES_H_INCLUDED\n");
+    fclose(file);
+    return true;
+}
+
+// Texel tuning: the evaluation is linear in the features, so the predicted result of a
+// position is a logistic function of the weights and full batch Adam fits them directly.
+int RunTuner(const char *dataFile, const char *headerFile, int epochs, int threadCount) {
+    TunerData data;
+    threadCount = max(1, threadCount);
+    time_t startTime = time(NULL);
+    if (!LoadTunerData(dataFile, threadCount, &data)) {
+        printf("No positions in %s.\n", dataFile);
+        FreeTunerData(&data);
+        return 1;
+    }
+    printf("%d positions loaded on %d threads in %.0f seconds\n", data.count, threadCount, difftime(time(NULL), startTime));
+
+    // Start from the tables the engine uses now
+    float *weights = (float*)calloc(EVAL_WEIGHTS, sizeof(float));
+    double *gradient = (double*)malloc(EVAL_WEIGHTS * sizeof(double));
+    double *moment = (double*)calloc(EVAL_WEIGHTS, sizeof(double));
+    double *velocity = (double*)calloc(EVAL_WEIGHTS, sizeof(double));
+    if (weights == NULL || gradient == NULL || moment == NULL || velocity == NULL) {
+        printf("Not enough memory for the weights.\n");
+        free(weights);
+        free(gradient);
+        free(moment);
+        free(velocity);
+        FreeTunerData(&data);
+        return 1;
+    }
+    for (int i = 0; i < 5; i++) {
+        weights[EVAL_MATERIAL + i] = (float)tunedMaterial[i];
+    }
+    for (int i = 0; i < 4; i++) {
+        weights[EVAL_MOBILITY + i] = (float)tunedMobility[i];
+    }
+    weights[EVAL_KING_SHIELD] = (float)tunedKingShield;
+    weights[EVAL_KING_ATTACK] = (float)tunedKingAttack;
+    for (int i = 0; i < 6 * 64; i++) {
+        weights[EVAL_TERMS + i] = (float)tunedPieceSquare[i / 64][i % 64];
+    }
+
+    const double beta1 = 0.9, beta2 = 0.999;
+    double loss = TunerGradient(&data, weights, threadCount, gradient);
+    if (loss >= 0) {
+        printf("Epoch %4d: loss %.6f\n", 0, loss);
+    }
+
+    for (int epoch = 1; epoch <= epochs && loss >= 0; epoch++) {
+        for (int w = 0; w < EVAL_WEIGHTS; w++) {
+            moment[w] = beta1 * moment[w] + (1 - beta1) * gradient[w];
+            velocity[w] = beta2 * velocity[w] + (1 - beta2) * gradient[w] * gradient[w];
+            double step = (moment[w] / (1 - pow(beta1, epoch))) / (sqrt(velocity[w] / (1 - pow(beta2, epoch))) + 1e-12);
+            weights[w] -= (float)(TUNER_LEARNING_RATE * step);
+        }
+        loss = TunerGradient(&data, weights, threadCount, gradient);
+        if (loss >= 0 && (epoch % 50 == 0 || epoch == epochs)) {
+            printf("Epoch %4d: loss %.6f\n", epoch, loss);
+        }
+    }
+
+    if (loss < 0) {
+        printf("Not enough memory for the gradient of %d threads.\n", threadCount);
+    }
+    bool isWritten = loss >= 0 && WriteEvalTables(headerFile, weights, data.count);
+    if (isWritten) {
+        printf("Tuned weights written to %s in %.0f seconds, rebuild to use them.\n", headerFile, difftime(time(NULL), startTime));
+    }
+    free(weights);
+    free(gradient);
+    free(moment);
+    free(velocity);
+    FreeTunerData(&data);
+    return isWritten ? 0 : 1;
+}
+
+//##########################-----END OF TUNER FUNCTIONS---------############################
+
+
+
+//##########################-----DISTRIBUTED ANALYSIS FUNCTIONS---------############################
+
+#if !defined(_WIN32)
+
+// The wire format is little endian binary with a fixed size for every message type
+static void WriteUint16(uint8_t *out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void WriteUint32(uint8_t *out, uint32_t value) {
+    WriteUint16(out, (uint16_t)value);
+    WriteUint16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t ReadUint16(const uint8_t *in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t ReadUint32(const uint8_t *in) {
+    return ReadUint16(in) | ((uint32_t)ReadUint16(in + 2) << 16);
+}
+
+static bool SendFully(int socket, const uint8_t *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(socket, buffer, size, 0);
+        if (sent <= 0) {
+            return false;
+        }
+        buffer += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+static bool ReceiveFully(int socket, uint8_t *buffer, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(socket, buffer, size, 0);
+        if (received <= 0) {
+            return false;
+        }
+        buffer += received;
+        size -= (size_t)received;
+    }
+    return true;
+}
+
+static bool SendJob(int socket, int jobId, int alpha, int beta, int depth, const Move *move, const PositionSnapshot *root) {
+    uint8_t message[JOB_MESSAGE_SIZE];
+    message[0] = MESSAGE_JOB;
+    WriteUint32(&message[1], (uint32_t)jobId);
+    WriteUint16(&message[5], (uint16_t)(int16_t)alpha);
+    WriteUint16(&message[7], (uint16_t)(int16_t)beta);
+    message[9] = (uint8_t)depth;
+    message[10] = (uint8_t)(move->startX * BOARD_SIZE + move->startY);
+    message[11] = (uint8_t)(move->endX * BOARD_SIZE + move->endY);
+    message[12] = (move->isCastlingMove ? 1 : 0) | (move->isPromotion ? 2 : 0);
+    memcpy(&message[13], root->squares, sizeof(root->squares));
+    message[45] = root->flags;
+    return SendFully(socket, message, sizeof(message));
+}
+
+static bool SendResult(int socket, int jobId, int score, unsigned long long nodes) {
+    uint8_t message[RESULT_MESSAGE_SIZE];
+    message[0] = MESSAGE_RESULT;
+    WriteUint32(&message[1], (uint32_t)jobId);
+    WriteUint16(&message[5], (uint16_t)(int16_t)score);
+    WriteUint32(&message[7], (uint32_t)nodes);
+    WriteUint32(&message[11], (uint32_t)(nodes >> 32));
+    return SendFully(socket, message, sizeof(message));
+}
+
+static bool SendByte(int socket, uint8_t type) {
+    return SendFully(socket, &type, 1);
+}
+
+// Young brothers wait: the first root move is searched alone to get a bound for the others.
+// After that pending moves go out first, and an idle worker steals a running move that only
+// one worker has, the first result of the two is kept.
+static int PickJob(DistributedJob *jobs, int jobCount) {
+    if (jobs[0].state != JOB_DONE) {
+        return (jobs[0].state == JOB_PENDING) ? 0 : -1;
+    }
+    for (int i = 1; i < jobCount; i++) {
+        if (jobs[i].state == JOB_PENDING) {
+            return i;
+        }
+    }
+    for (int i = 1; i < jobCount; i++) {
+        if (jobs[i].state == JOB_RUNNING && jobs[i].assigned == 1) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#endif
+
+int RunCoordinator(const char *program, const char *fen, int depth, int port, int localWorkers) {
+    #if defined(_WIN32)
+        printf("Distributed analysis needs POSIX sockets, it is not supported on Windows.\n");
+        return 1;
+    #else
+        Board board;
+        FenState state;
+        ClearBoard(&board);
+        if (!ParseFEN(&board, fen, &state)) {
+            printf("Invalid FEN \"%s\".\n", fen);
+            FreeBoard(&board);
+            return 1;
+        }
+        depth = max(1, min(depth, 12));
+
+        // One job for every root move, captures first so the eldest brother is a good one
+        Move moves[MAX_LEGAL_MOVES];
+        DistributedJob jobs[MAX_LEGAL_MOVES];
+        int jobCount = GenerateLegalMoves(&board, state.sideToMove, moves);
+        if (jobCount == 0) {
+            printf("No legal moves: %s.\n", IsKingInCheck(&board, state.sideToMove) ? "checkmate" : "stalemate");
+            FreeBoard(&board);
+            return 0;
+        }
+        int captures = 0;
+        for (int i = 0; i < jobCount; i++) {
+            if (moves[i].pieceCaptured != 0) {
+                Move swap = moves[captures];
+                moves[captures++] = moves[i];
+                moves[i] = swap;
+            }
+        }
+        for (int i = 0; i < jobCount; i++) {
+            jobs[i].move = moves[i];
+            jobs[i].state = JOB_PENDING;
+            jobs[i].assigned = 0;
+            jobs[i].score = 0;
+        }
+        PositionSnapshot root;
+        TakeSnapshot(&board, state.sideToMove, &root);
+        FreeBoard(&board);
+
+        // Listen before starting the local workers, so they can connect at once
+        signal(SIGPIPE, SIG_IGN);
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        int yes = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        struct sockaddr_in address = {0};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons((uint16_t)port);
+        if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+            printf("Error listening on port %d.\n", port);
+            if (listener >= 0) {
+                close(listener);
+            }
+            return 1;
+        }
+
+        char portText[16];
+        snprintf(portText, sizeof(portText), "%d", port);
+        pid_t children[MAX_WORKERS];
+        localWorkers = max(0, min(localWorkers, MAX_WORKERS));
+        int liveChildren = 0;
+        for (int i = 0; i < localWorkers; i++) {
+            children[i] = fork();
+            if (children[i] == 0) {
+                // argv[0] may be a name found on the PATH, so run our own binary when the system can tell us where it is
+                char *arguments[] = {(char*)program, "--worker", "127.0.0.1", portText, NULL};
+                close(listener);
+                execv("/proc/self/exe", arguments);
+                execvp(program, arguments);
+                _exit(1);
+            }
+            liveChildren += (children[i] > 0);
+        }
+        printf("Analysing %d root moves to depth %d, waiting for workers on port %d (%d local).\n",
+               jobCount, depth, port, localWorkers);
+
+        DistributedWorker workers[MAX_WORKERS];
+        struct pollfd polls[MAX_WORKERS + 1];
+        int workerCount = 0;
+        int doneCount = 0;
+        int best = -1;
+        int bestScore = -MATE_SCORE - 1;
+        unsigned long long nodes = 0;
+        time_t startTime = time(NULL);
+
+        while (doneCount < jobCount) {
+            polls[0].fd = listener;
+            polls[0].events = POLLIN;
+            for (int i = 0; i < workerCount; i++) {
+                polls[i + 1].fd = workers[i].socket;
+                polls[i + 1].events = POLLIN;
+            }
+            int ready = poll(polls, workerCount + 1, 1000);
+
+            // Local workers that could not start or died never connect, so do not wait for them forever
+            for (int i = 0; i < localWorkers; i++) {
+                if (children[i] > 0 && waitpid(children[i], NULL, WNOHANG) == children[i]) {
+                    children[i] = -1;
+                    liveChildren--;
+                }
+            }
+            if (localWorkers > 0 && liveChildren == 0 && workerCount == 0 && !(ready > 0 && (polls[0].revents & POLLIN))) {
+                printf("All local workers exited and no worker is connected, the analysis stops.\n");
+                close(listener);
+                return 1;
+            }
+            if (ready <= 0) {
+                continue;
+            }
+
+            int polled = workerCount; // a worker accepted now has no poll result yet
+            if ((polls[0].revents & POLLIN) && workerCount < MAX_WORKERS) {
+                int client = accept(listener, NULL, NULL);
+                if (client >= 0) {
+                    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                    workers[workerCount].socket = client;
+                    workers[workerCount].isIdle = false;
+                    workers[workerCount].currentJob = -1;
+                    workers[workerCount].jobsDone = 0;
+                    workerCount++;
+                }
+            }
+
+            for (int i = polled - 1; i >= 0; i--) {
+                DistributedWorker *worker = &workers[i];
+                uint8_t message[RESULT_MESSAGE_SIZE];
+                if (!(polls[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                    continue;
+                }
+
+                bool isAlive = ReceiveFully(worker->socket, message, 1);
+                if (isAlive && message[0] == MESSAGE_RESULT) {
+                    isAlive = ReceiveFully(worker->socket, message + 1, RESULT_MESSAGE_SIZE - 1);
+                }
+                if (!isAlive) {
+                    // Give the job of a lost worker back, unless someone else is searching it too
+                    if (worker->currentJob >= 0 && jobs[worker->currentJob].state == JOB_RUNNING &&
+                        --jobs[worker->currentJob].assigned == 0) {
+                        jobs[worker->currentJob].state = JOB_PENDING;
+                    }
+                    close(worker->socket);
+                    workers[i] = workers[--workerCount];
+                    continue;
+                }
+
+                if (message[0] == MESSAGE_RESULT) {
+                    int job = (int)ReadUint32(&message[1]);
+                    int score = (int16_t)ReadUint16(&message[5]);
+                    nodes += ReadUint32(&message[7]) | ((unsigned long long)ReadUint32(&message[11]) << 32);
+                    if (job >= 0 && job < jobCount && jobs[job].state != JOB_DONE) {
+                        jobs[job].state = JOB_DONE;
+                        jobs[job].score = score;
+                        doneCount++;
+                        if (score > bestScore) {
+                            bestScore = score;
+                            best = job;
+                        }
+                    }
+                    worker->jobsDone++;
+                }
+                worker->currentJob = -1;
+                worker->isIdle = true;
+            }
+
+            // Hand out work, the bound of the best move so far makes the other moves cheaper
+            for (int i = 0; i < workerCount; i++) {
+                if (!workers[i].isIdle) {
+                    continue;
+                }
+                int job = PickJob(jobs, jobCount);
+                if (job < 0) {
+                    break;
+                }
+                if (SendJob(workers[i].socket, job, max(bestScore, -MATE_SCORE - 1), MATE_SCORE + 1, depth, &jobs[job].move, &root)) {
+                    workers[i].isIdle = false;
+                    workers[i].currentJob = job;
+                    jobs[job].state = JOB_RUNNING;
+                    jobs[job].assigned++;
+                }
+            }
+        }
+
+        for (int i = 0; i < workerCount; i++) {
+            SendByte(workers[i].socket, MESSAGE_QUIT);
+            close(workers[i].socket);
+        }
+        close(listener);
+        for (int i = 0; i < localWorkers; i++) {
+            if (children[i] > 0) {
+                waitpid(children[i], NULL, 0);
+            }
+        }
+
+        char text[8];
+        MoveToString(&jobs[best].move, text);
+        printf("Best move %s, score %d at depth %d, %llu nodes, %.0f seconds\n",
+               text, bestScore, depth, nodes, difftime(time(NULL), startTime));
+        return 0;
+    #endif
+}
+
+int RunWorker(const char *host, int port) {
+    #if defined(_WIN32)
+        printf("Distributed analysis needs POSIX sockets, it is not supported on Windows.\n");
+        return 1;
+    #else
+        signal(SIGPIPE, SIG_IGN); // A coordinator that went away is an error from send, not the end of the process
+        char portText[16];
+        struct addrinfo hints = {0};
+        struct addrinfo *address = NULL;
+        snprintf(portText, sizeof(portText), "%d", port);
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, portText, &hints, &address) != 0) {
+            printf("Unknown coordinator host %s.\n", host);
+            return 1;
+        }
+
+        int server = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        int yes = 1;
+        bool isConnected = false;
+        for (int attempt = 0; attempt < 50 && server >= 0 && !isConnected; attempt++) {
+            isConnected = connect(server, address->ai_addr, address->ai_addrlen) == 0;
+            if (!isConnected) {
+                usleep(100000); // The coordinator may still be starting
+            }
+        }
+        freeaddrinfo(address);
+        if (!isConnected) {
+            printf("Error connecting to %s:%d.\n", host, port);
+            return 1;
+        }
+        setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        EngineConfig config;
+        SetDefaultEngineConfig(&config);
+        uint8_t message[JOB_MESSAGE_SIZE];
+        bool isWorking = SendByte(server, MESSAGE_REQUEST);
+        bool isRejected = false; // the coordinator sent a job that is not valid
+
+        while (isWorking && ReceiveFully(server, message, 1) && message[0] == MESSAGE_JOB &&
+               ReceiveFully(server, message + 1, JOB_MESSAGE_SIZE - 1)) {
+            int jobId = (int)ReadUint32(&message[1]);
+            int alpha = (int16_t)ReadUint16(&message[5]);
+            int beta = (int16_t)ReadUint16(&message[7]);
+            int depth = message[9];
+
+            // The job comes from the network, so check all of it before the board is touched
+            PositionSnapshot root;
+            memcpy(root.squares, &message[13], sizeof(root.squares));
+            root.flags = message[45];
+            bool isValidJob = depth >= 1 && depth <= 12 && message[10] < 64 && message[11] < 64;
+            for (int square = 0; square < BOARD_SIZE * BOARD_SIZE && isValidJob; square++) {
+                int code = (root.squares[square / 2] >> (4 * (square % 2))) & 0xF;
+                isValidJob = code == 0 || ((code & 7) >= 1 && (code & 7) <= 6);
+            }
+            if (!isValidJob) {
+                printf("Worker: job %d from the coordinator is not valid, disconnecting.\n", jobId);
+                isRejected = true;
+                break;
+            }
+
+            Board board;
+            char sideToMove;
+            RestoreSnapshot(&root, &board, &sideToMove);
+            FenState state = {sideToMove, root.flags >> 1, -1, -1, 0, 1};
+
+            // Only a legal move of a legal position is searched, the generated move also has the right flags
+            Move moves[MAX_LEGAL_MOVES];
+            int count = (ValidatePosition(&board, &state) == NULL) ? GenerateLegalMoves(&board, sideToMove, moves) : 0;
+            int found = -1;
+            for (int i = 0; i < count && found < 0; i++) {
+                if (moves[i].startX * BOARD_SIZE + moves[i].startY == message[10] &&
+                    moves[i].endX * BOARD_SIZE + moves[i].endY == message[11]) {
+                    found = i;
+                }
+            }
+            if (found < 0) {
+                printf("Worker: job %d from the coordinator is not a legal move, disconnecting.\n", jobId);
+                FreeBoard(&board);
+                isRejected = true;
+                break;
+            }
+            Move move = moves[found];
+
+            MoveUndo undo;
+            unsigned long long nodes = 0;
+            MakeMove(&board, &move, &undo);
+            int score = -SearchPosition(&board, OpponentColor(sideToMove), depth - 1, -beta, -alpha, 1, &config, &nodes);
+            free(undo.captured);
+            FreeBoard(&board);
+
+            isWorking = SendResult(server, jobId, score, nodes);
+        }
+
+        close(server);
+        return isRejected ? 1 : 0;
+    #endif
+}
+
+//##########################-----END OF DISTRIBUTED ANALYSIS FUNCTIONS---------############################
+
+
+
+//##########################-----BENCHMARK FUNCTIONS---------############################
+
+// IsLegalMove as it was before the move tables: a switch on the type letter and a color test
+// in MovePawn. It is only kept so the benchmark has something to compare with.
+static bool SwitchIsLegalMove(Board *board, int startX, int startY, int endX, int endY, Player *player) {
+    Piece *movingPiece = board->board[startX][startY];
+    Piece *destinationPiece = board->board[endX][endY];
+    if (movingPiece == NULL || movingPiece->color != player->color ||
+        (destinationPiece != NULL && destinationPiece->color == player->color)) {
+        return false;
+    }
+
+    switch (toupper(movingPiece->type)) {
+        case 'K':
+            return MoveKing(board, startX, startY, endX, endY, player);
+        case 'Q':
+            return MoveQueen(board, startX, startY, endX, endY, player);
+        case 'R':
+            return MoveRook(board, startX, startY, endX, endY, player);
+        case 'B':
+            return MoveBishop(board, startX, startY, endX, endY, player);
+        case 'N':
+            return MoveKnight(board, startX, startY, endX, endY, player);
+        case 'P':
+            return (movingPiece->color == 'W') ? MovePawnWhite(board, startX, startY, endX, endY, player)
+                                               : MovePawnBlack(board, startX, startY, endX, endY, player);
+        default:
+            return false;
+    }
+}
+
+// Open a counter of the branch mispredictions of this process, -1 when the system has none
+static int OpenBranchMissCounter(void) {
+    #if defined(__linux__)
+        struct perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+    #else
+        return -1;
+    #endif
+}
+
+// Validate every from/to pair of every position, return how many moves were allowed
+static long BenchmarkPass(Board *boards, int boardCount, int iterations, bool useTables,
+                          int counter, long long *branchMisses, double *seconds) {
+    long allowed = 0;
+    clock_t start = clock();
+
+    #if defined(__linux__)
+        if (counter >= 0) {
+            ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    #endif
+
+    for (int n = 0; n < iterations; n++) {
+        for (int b = 0; b < boardCount; b++) {
+            Board *board = &boards[b];
+            for (int from = 0; from < BOARD_SIZE * BOARD_SIZE; from++) {
+                Piece *piece = board->board[from / BOARD_SIZE][from % BOARD_SIZE];
+                if (piece == NULL) {
+                    continue;
+                }
+                Player player = {0};
+                player.color = piece->color;
+                player.hasMovedKing = true;
+                player.hasMovedRook = true;
+                for (int to = 0; to < BOARD_SIZE * BOARD_SIZE; to++) {
+                    if (to == from) {
+                        continue;
+                    }
+                    allowed += useTables
+                        ? IsLegalMove(board, from / BOARD_SIZE, from % BOARD_SIZE, to / BOARD_SIZE, to % BOARD_SIZE, &player)
+                        : SwitchIsLegalMove(board, from / BOARD_SIZE, from % BOARD_SIZE, to / BOARD_SIZE, to % BOARD_SIZE, &player);
+                }
+            }
+        }
+    }
+
+    *branchMisses = -1;
+    #if defined(__linux__)
+        if (counter >= 0) {
+            ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(counter, branchMisses, sizeof(*branchMisses)) != sizeof(*branchMisses)) {
+                *branchMisses = -1;
+            }
+        }
+    #endif
+    *seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    return allowed;
+}
+
+int RunMoveBenchmark(int iterations) {
+    // Openings, middle games and endings, so the piece types come in a mixed order
+    static const char *positions[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bq1rk1/pp2ppbp/2np1np1/8/3NP3/2N1BP2/PPPQ2PP/R3KB1R w KQ - 3 9",
+        "r2q1rk1/pb1nbppp/1p2pn2/2pp4/2PP4/1PN1PN2/PB2BPPP/R2Q1RK1 w - - 0 10",
+        "2r3k1/pp3ppp/2n1b3/3p4/3P4/2N1B3/PP3PPP/2R3K1 b - - 0 20",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "8/5pk1/6p1/8/3N4/6P1/5PK1/8 w - - 0 40"
+    };
+    int boardCount = sizeof(positions) / sizeof(positions[0]);
+    Board boards[sizeof(positions) / sizeof(positions[0])];
+
+    long long pieceCount = 0;
+    for (int b = 0; b < boardCount; b++) {
+        FenState state;
+        ClearBoard(&boards[b]);
+        ParseFEN(&boards[b], positions[b], &state);
+        for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++) {
+            pieceCount += boards[b].board[square / BOARD_SIZE][square % BOARD_SIZE] != NULL;
+        }
+    }
+
+    int counter = OpenBranchMissCounter();
+    if (counter < 0) {
+        printf("Branch miss counter not available, only the time is measured.\n");
+    }
+
+    const char *names[2] = {"switch on type", "piece code table"};
+    long long misses[2];
+    double seconds[2];
+    long allowed[2];
+    for (int pass = 0; pass < 2; pass++) {
+        allowed[pass] = BenchmarkPass(boards, boardCount, iterations, pass == 1, counter, &misses[pass], &seconds[pass]);
+        long long checks = (long long)iterations * pieceCount * (BOARD_SIZE * BOARD_SIZE - 1);
+        printf("%-17s %.3f seconds, %.1f ns per piece check", names[pass], seconds[pass], seconds[pass] * 1e9 / checks);
+        if (misses[pass] >= 0) {
+            printf(", %lld branch misses", misses[pass]);
+        }
+        printf("\n");
+    }
+
+    if (allowed[0] != allowed[1]) {
+        printf("The two ways disagree: %ld and %ld moves allowed!\n", allowed[0], allowed[1]);
+    } else if (misses[0] > 0 && misses[1] >= 0) {
+        printf("The tables have %.1f%% fewer branch misses.\n", 100.0 * (misses[0] - misses[1]) / misses[0]);
+    }
+
+    #if !defined(_WIN32)
+        if (counter >= 0) {
+            close(counter);
+        }
+    #endif
+    for (int b = 0; b < boardCount; b++) {
+        FreeBoard(&boards[b]);
+    }
+    return (allowed[0] == allowed[1]) ? 0 : 1;
+}
+
+//##########################-----END OF BENCHMARK FUNCTIONS---------############################
+
+
+
+//##########################-----ANALYSIS CACHE FUNCTIONS---------############################
+
+// Pack a PositionInfo into 64 bits:
+// legal moves (8) | status (2) | has best move (1) | from (6) | to (6) | score (16) | depth (8) | generation (8) | used (1)
+static uint64_t PackPositionInfo(const PositionInfo *info, uint8_t generation) {
+    uint64_t data = (uint64_t)(info->legalMoveCount & 0xFF);
+    data |= (uint64_t)(info->status & 0x3) << 8;
+    data |= (uint64_t)(info->hasBestMove ? 1 : 0) << 10;
+    data |= (uint64_t)((info->bestStartX * BOARD_SIZE + info->bestStartY) & 0x3F) << 11;
+    data |= (uint64_t)((info->bestEndX * BOARD_SIZE + info->bestEndY) & 0x3F) << 17;
+    data |= (uint64_t)(uint16_t)(int16_t)info->score << 23;
+    data |= (uint64_t)min(max(info->depth, 0), 255) << 39;
+    data |= (uint64_t)generation << 47;
+    data |= 1ULL << 63; // An all zero slot is an empty slot
+    return data;
+}
+
+static void UnpackPositionInfo(uint64_t data, PositionInfo *info) {
+    info->legalMoveCount = (int)(data & 0xFF);
+    info->status = (int)((data >> 8) & 0x3);
+    info->hasBestMove = ((data >> 10) & 1) != 0;
+    info->bestStartX = (int)((data >> 11) & 0x3F) / BOARD_SIZE;
+    info->bestStartY = (int)((data >> 11) & 0x3F) % BOARD_SIZE;
+    info->bestEndX = (int)((data >> 17) & 0x3F) / BOARD_SIZE;
+    info->bestEndY = (int)((data >> 17) & 0x3F) % BOARD_SIZE;
+    info->score = (int16_t)((data >> 23) & 0xFFFF);
+    info->depth = (int)((data >> 39) & 0xFF);
+}
+
+static uint8_t EntryGeneration(uint64_t data) {
+    return (uint8_t)((data >> 47) & 0xFF);
+}
+
+static int EntryDepth(uint64_t data) {
+    return (int)((data >> 39) & 0xFF);
+}
+
+AnalysisCache* OpenAnalysisCache(const char *fileName, uint64_t maxBytes) {
+    #if defined(_WIN32)
+        printf("The analysis cache needs mmap, it is not supported on Windows.\n");
+        return NULL;
+    #else
+        int fd = open(fileName, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            printf("Error opening analysis cache %s.\n", fileName);
+            return NULL;
+        }
+
+        // Only one process at a time creates or checks the header
+        flock(fd, LOCK_EX);
+
+        struct stat fileStat;
+        fstat(fd, &fileStat);
+        bool isNew = (fileStat.st_size == 0);
+        uint64_t bucketBytes = ANALYSIS_BUCKET_SIZE * sizeof(AnalysisEntry);
+        uint64_t bucketCount = 1;
+        size_t size = (size_t)fileStat.st_size;
+
+        if (isNew) {
+            // The largest power of two number of buckets that fits in the size limit, the header comes on top
+            while (bucketCount * 2 * bucketBytes <= maxBytes) {
+                bucketCount *= 2;
+            }
+            size = sizeof(AnalysisHeader) + bucketCount * bucketBytes;
+            if (ftruncate(fd, (off_t)size) != 0) {
+                printf("Error growing analysis cache %s.\n", fileName);
+                flock(fd, LOCK_UN);
+                close(fd);
+                return NULL;
+            }
+        }
+
+        void *mapping = (size >= sizeof(AnalysisHeader))
+            ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+            : MAP_FAILED;
+        if (mapping == MAP_FAILED) {
+            printf("Error mapping analysis cache %s.\n", fileName);
+            flock(fd, LOCK_UN);
+            close(fd);
+            return NULL;
+        }
+
+        AnalysisHeader *header = (AnalysisHeader*)mapping;
+        if (isNew) {
+            header->version = ANALYSIS_CACHE_VERSION;
+            header->bucketCount = bucketCount;
+            header->generation = 0;
+            header->magic = ANALYSIS_CACHE_MAGIC;
+        } else if (header->magic != ANALYSIS_CACHE_MAGIC || header->version != ANALYSIS_CACHE_VERSION ||
+                   sizeof(AnalysisHeader) + header->bucketCount * bucketBytes != size) {
+            printf("Analysis cache %s has an unknown format, delete it to start a new one.\n", fileName);
+            munmap(mapping, size);
+            flock(fd, LOCK_UN);
+            close(fd);
+            return NULL;
+        }
+
+        flock(fd, LOCK_UN);
+        close(fd); // The mapping stays valid
+
+        AnalysisCache *cache = (AnalysisCache*)malloc(sizeof(AnalysisCache));
+        if (cache == NULL) {
+            printf("Not enough memory for analysis cache %s.\n", fileName);
+            munmap(mapping, size);
+            return NULL;
+        }
+        cache->header = header;
+        cache->entries = (AnalysisEntry*)(header + 1);
+        cache->mappedSize = size;
+        // Every run writes a new generation, entries of old runs are replaced first
+        cache->generation = (uint8_t)__atomic_add_fetch(&header->generation, 1, __ATOMIC_RELAXED);
+        return cache;
+    #endif
+}
+
+void CloseAnalysisCache(AnalysisCache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    #if !defined(_WIN32)
+        munmap(cache->header, cache->mappedSize);
+    #endif
+    free(cache);
+}
+
+// Slots are read and written without locks. Each slot stores key ^ data next to data,
+// so a slot that two processes wrote at the same time simply does not match any key.
+bool ProbeAnalysisCache(AnalysisCache *cache, uint64_t key, PositionInfo *info) {
+    AnalysisEntry *bucket = &cache->entries[(key & (cache->header->bucketCount - 1)) * ANALYSIS_BUCKET_SIZE];
+
+    for (int i = 0; i < ANALYSIS_BUCKET_SIZE; i++) {
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+        if ((data >> 63) != 0 && (check ^ data) == key) {
+            UnpackPositionInfo(data, info);
+            return true;
+        }
+    }
+    return false;
+}
+
+void StoreAnalysisCache(AnalysisCache *cache, uint64_t key, const PositionInfo *info) {
+    AnalysisEntry *bucket = &cache->entries[(key & (cache->header->bucketCount - 1)) * ANALYSIS_BUCKET_SIZE];
+    AnalysisEntry *replace = NULL;
+    int worst = 1 << 30;
+
+    for (int i = 0; i < ANALYSIS_BUCKET_SIZE; i++) {
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+
+        if ((data >> 63) != 0 && (check ^ data) == key) {
+            // Never trade a deeper result of the same position for a shallower one
+            if (EntryDepth(data) > info->depth) {
+                return;
+            }
+            replace = &bucket[i];
+            break;
+        }
+        if ((data >> 63) == 0) {
+            replace = &bucket[i];
+            worst = -(1 << 30);
+            continue;
+        }
+
+        // Shallow entries of old generations are the least useful
+        int age = (uint8_t)(cache->generation - EntryGeneration(data));
+        int worth = EntryDepth(data) - 8 * age;
+        if (worth < worst) {
+            worst = worth;
+            replace = &bucket[i];
+        }
+    }
+
+    uint64_t data = PackPositionInfo(info, cache->generation);
+    __atomic_store_n(&replace->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&replace->check, key ^ data, __ATOMIC_RELAXED);
+}
+
+void AnalysePosition(Board *board, char sideToMove, PositionInfo *info) {
+    uint64_t key = 0;
+    if (analysisCache != NULL) {
+        key = HashBoard(board, sideToMove);
+        if (ProbeAnalysisCache(analysisCache, key, info)) {
+            return;
+        }
+    }
+
+    Move moves[MAX_LEGAL_MOVES];
+    bool inCheck = IsKingInCheck(board, sideToMove);
+    memset(info, 0, sizeof(PositionInfo));
+    info->legalMoveCount = GenerateLegalMoves(board, sideToMove, moves);
+    if (info->legalMoveCount == 0) {
+        info->status = inCheck ? POSITION_CHECKMATE : POSITION_STALEMATE;
+        info->score = inCheck ? -MATE_SCORE : 0;
+    } else {
+        info->status = inCheck ? POSITION_CHECK : POSITION_NORMAL;
+    }
+
+    if (analysisCache != NULL) {
+        StoreAnalysisCache(analysisCache, key, info);
+    }
+}
+
+//##########################-----END OF ANALYSIS CACHE FUNCTIONS---------############################
+
+
+
+//##########################-----BROADCAST FUNCTIONS---------############################
+
+LiveBroadcast* OpenBroadcast(const char *fileName, bool isPublisher) {
+    #if defined(_WIN32)
+        printf("The broadcast needs mmap, it is not supported on Windows.\n");
+        return NULL;
+    #else
+        int fd = open(fileName, isPublisher ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (fd < 0) {
+            printf("Error opening broadcast %s.\n", fileName);
+            return NULL;
+        }
+
+        // Only one process at a time creates or checks the header
+        flock(fd, isPublisher ? LOCK_EX : LOCK_SH);
+
+        struct stat fileStat;
+        fstat(fd, &fileStat);
+        bool isNew = (fileStat.st_size == 0);
+        size_t size = (size_t)fileStat.st_size;
+
+        if (isNew && isPublisher) {
+            size = sizeof(BroadcastHeader) + BROADCAST_SLOTS * sizeof(BroadcastFrame);
+            if (ftruncate(fd, (off_t)size) != 0) {
+                printf("Error growing broadcast %s.\n", fileName);
+                flock(fd, LOCK_UN);
+                close(fd);
+                return NULL;
+            }
+        }
+
+        void *mapping = (size >= sizeof(BroadcastHeader))
+            ? mmap(NULL, size, isPublisher ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0)
+            : MAP_FAILED;
+        if (mapping == MAP_FAILED) {
+            printf("Error mapping broadcast %s.\n", fileName);
+            flock(fd, LOCK_UN);
+            close(fd);
+            return NULL;
+        }
+
+        BroadcastHeader *header = (BroadcastHeader*)mapping;
+        if (isNew && isPublisher) {
+            header->version = BROADCAST_VERSION;
+            header->slotCount = BROADCAST_SLOTS;
+            header->head = 0;
+            header->magic = BROADCAST_MAGIC;
+        } else if (header->magic != BROADCAST_MAGIC || header->version != BROADCAST_VERSION ||
+                   sizeof(BroadcastHeader) + header->slotCount * sizeof(BroadcastFrame) != size) {
+            printf("Broadcast %s has an unknown format, delete it to start a new one.\n", fileName);
+            munmap(mapping, size);
+            flock(fd, LOCK_UN);
+            close(fd);
+            return NULL;
+        }
+
+        flock(fd, LOCK_UN);
+        close(fd); // The mapping stays valid
+
+        LiveBroadcast *broadcast = (LiveBroadcast*)malloc(sizeof(LiveBroadcast));
+        broadcast->header = header;
+        broadcast->frames = (BroadcastFrame*)(header + 1);
+        broadcast->mappedSize = size;
+        return broadcast;
+    #endif
+}
+
+void CloseBroadcast(LiveBroadcast *broadcast) {
+    if (broadcast == NULL) {
+        return;
+    }
+    #if !defined(_WIN32)
+        munmap(broadcast->header, broadcast->mappedSize);
+    #endif
+    free(broadcast);
+}
+
+// Every frame is a seqlock: the sequence is odd while the frame is written and tells which
+// frame number the slot holds. Publishers never wait, a spectator that reads a frame while
+// it changes sees a different sequence after the copy and tries again.
+void PublishPosition(LiveBroadcast *broadcast, uint32_t gameId, Board *board, char sideToMove, const Move *lastMove,
+                     int ply, int status, const Player *white, const Player *black) {
+    uint64_t number = __atomic_fetch_add(&broadcast->header->head, 1, __ATOMIC_RELAXED);
+    BroadcastFrame *frame = &broadcast->frames[number & (broadcast->header->slotCount - 1)];
+
+    __atomic_store_n(&frame->sequence, 2 * number + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    TakeSnapshot(board, sideToMove, &frame->position);
+    frame->status = (uint8_t)status;
+    frame->lastMove = (lastMove != NULL) ? PackMove(lastMove) : 0;
+    frame->ply = (uint16_t)ply;
+    frame->gameId = gameId;
+    frame->timeLeft[0] = (int32_t)white->timeLeft;
+    frame->timeLeft[1] = (int32_t)black->timeLeft;
+
+    __atomic_store_n(&frame->sequence, 2 * number + 2, __ATOMIC_RELEASE);
+}
+
+bool ReadBroadcastFrame(const LiveBroadcast *broadcast, uint64_t number, BroadcastFrame *frame) {
+    const BroadcastFrame *slot = &broadcast->frames[number & (broadcast->header->slotCount - 1)];
+
+    uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+    if (sequence != 2 * number + 2) {
+        return false;
+    }
+    memcpy(frame, slot, sizeof(BroadcastFrame));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == sequence;
+}
+
+static void PrintBroadcastFrame(const BroadcastFrame *frame) {
+    Board board;
+    Player white, black;
+    Game game;
+    char sideToMove;
+    char move[8] = "-";
+
+    RestoreSnapshot(&frame->position, &board, &sideToMove);
+    InitializePlayers(&white, &black);
+    white.timeLeft = frame->timeLeft[0];
+    black.timeLeft = frame->timeLeft[1];
+    game.board = &board;
+    game.players[0] = &white;
+    game.players[1] = &black;
+    game.currentPlayer = (sideToMove == 'W') ? 0 : 1;
+    game.moveCount = 0;
+    PrintBoard(&board, &game);
+
+    if (frame->lastMove != 0) {
+        ConvertIndicesToAlgebraic((frame->lastMove & 63) / BOARD_SIZE, (frame->lastMove & 63) % BOARD_SIZE, move);
+        move[2] = '-';
+        ConvertIndicesToAlgebraic(((frame->lastMove >> 6) & 63) / BOARD_SIZE, ((frame->lastMove >> 6) & 63) % BOARD_SIZE, move + 3);
+    }
+    static const char *statusNames[] = {"", "check", "checkmate", "stalemate"};
+    printf("Game %u, ply %d, last move %s, %s to move %s\n", frame->gameId, frame->ply, move,
+           sideToMove == 'W' ? "white" : "black", statusNames[frame->status & 3]);
+    fflush(stdout);
+    FreeBoard(&board);
+}
+
+int RunSpectator(const char *fileName, long gameId) {
+    LiveBroadcast *broadcast = OpenBroadcast(fileName, false);
+    if (broadcast == NULL) {
+        return 1;
+    }
+
+    // Start at the newest frame, older positions are not interesting to someone who just joined
+    uint64_t slotCount = broadcast->header->slotCount;
+    uint64_t head = __atomic_load_n(&broadcast->header->head, __ATOMIC_ACQUIRE);
+    uint64_t next = (head > 0) ? head - 1 : 0;
+    int retries = 0;
+
+    while (true) {
+        head = __atomic_load_n(&broadcast->header->head, __ATOMIC_ACQUIRE);
+        if (next >= head) {
+            #if !defined(_WIN32)
+                usleep(20000); // OpenBroadcast fails on Windows, so only POSIX gets here
+            #endif
+            continue;
+        }
+        if (head - next > slotCount) {
+            next = head - 1; // Lapped, the frames in between are gone so go on with the newest one
+        }
+
+        BroadcastFrame frame;
+        if (!ReadBroadcastFrame(broadcast, next, &frame)) {
+            uint64_t sequence = __atomic_load_n(&broadcast->frames[next & (slotCount - 1)].sequence, __ATOMIC_ACQUIRE);
+            if (sequence > 2 * next + 2) {
+                // A newer frame took the slot while we read it, retrying cannot bring ours back
+                next = __atomic_load_n(&broadcast->header->head, __ATOMIC_ACQUIRE) - 1;
+                retries = 0;
+                continue;
+            }
+            // The publisher is still writing it, unless it died in the middle
+            if (++retries < 1000) {
+                continue;
+            }
+        } else if (gameId < 0 || frame.gameId == (uint32_t)gameId) {
+            PrintBroadcastFrame(&frame);
+            if (gameId >= 0 && (frame.status == POSITION_CHECKMATE || frame.status == POSITION_STALEMATE)) {
+                break; // The game we follow is over
+            }
+        }
+        retries = 0;
+        next++;
+    }
+
+    CloseBroadcast(broadcast);
+    return 0;
+}
+
+//##########################-----END OF BROADCAST FUNCTIONS---------############################
+
+
+
+//##########################-----JOURNAL FUNCTIONS---------############################
+
+static void WriteJournalRecord(const JournalRecord *record, uint8_t *out) {
+    out[0] = record->type;
+    out[1] = 0;
+    out[2] = (uint8_t)record->ply;
+    out[3] = (uint8_t)(record->ply >> 8);
+    for (int i = 0; i < 4; i++) {
+        out[4 + i] = (uint8_t)(record->gameId >> (8 * i));
+    }
+    out[8] = (uint8_t)record->move;
+    out[9] = (uint8_t)(record->move >> 8);
+    out[10] = (uint8_t)record->seconds;
+    out[11] = (uint8_t)(record->seconds >> 8);
+
+    // FNV-1a of the record, a record the crash cut in half does not match it
+    uint32_t check = 2166136261u;
+    for (int i = 0; i < 12; i++) {
+        check = (check ^ out[i]) * 16777619u;
+    }
+    for (int i = 0; i < 4; i++) {
+        out[12 + i] = (uint8_t)(check >> (8 * i));
+    }
+}
+
+static bool ReadJournalRecord(const uint8_t *in, JournalRecord *record) {
+    uint32_t check = 2166136261u;
+    for (int i = 0; i < 12; i++) {
+        check = (check ^ in[i]) * 16777619u;
+    }
+    uint32_t stored = in[12] | (in[13] << 8) | (in[14] << 16) | ((uint32_t)in[15] << 24);
+
+    record->type = in[0];
+    record->ply = (uint16_t)(in[2] | (in[3] << 8));
+    record->gameId = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+    record->move = (uint16_t)(in[8] | (in[9] << 8));
+    record->seconds = (uint16_t)(in[10] | (in[11] << 8));
+    return check == stored && record->type <= JOURNAL_END;
+}
+
+static bool SyncJournalFile(FILE *file) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+    #if defined(_WIN32)
+        return _commit(_fileno(file)) == 0;
+    #else
+        return fdatasync(fileno(file)) == 0;
+    #endif
+}
+
+// Called with the lock held, the first failure is reported and the journal stays failed
+static void FailJournal(GameJournal *journal) {
+    if (!journal->failed) {
+        fprintf(stderr, "Error writing the game journal, moves after this one may not be recorded.\n");
+        journal->failed = true;
+    }
+}
+
+// Group commit: the move path only copies its record into a buffer. This thread writes the
+// whole buffer with one fsync when JOURNAL_BATCH_RECORDS are waiting or JOURNAL_FLUSH_MS passed.
+static void* JournalFlusher(void *argument) {
+    GameJournal *journal = (GameJournal*)argument;
+
+    pthread_mutex_lock(&journal->lock);
+    while (true) {
+        if (journal->used == 0 && !journal->isStopping) {
+            pthread_cond_wait(&journal->wake, &journal->lock);
+        }
+        if (journal->used > 0 && journal->used < JOURNAL_BATCH_RECORDS * JOURNAL_RECORD_SIZE && !journal->isStopping) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += JOURNAL_FLUSH_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&journal->wake, &journal->lock, &deadline);
+        }
+        if (journal->used == 0) {
+            if (journal->isStopping) {
+                break;
+            }
+            continue;
+        }
+
+        // Appends go to the other buffer while this one is written
+        int full = journal->active;
+        size_t size = journal->used;
+        journal->active = 1 - full;
+        journal->used = 0;
+        pthread_mutex_unlock(&journal->lock);
+
+        bool isWritten = fwrite(journal->buffers[full], 1, size, journal->file) == size &&
+                         SyncJournalFile(journal->file);
+
+        pthread_mutex_lock(&journal->lock);
+        if (!isWritten) {
+            FailJournal(journal);
+        }
+        journal->syncs++;
+    }
+    pthread_mutex_unlock(&journal->lock);
+    return NULL;
+}
+
+GameJournal* OpenJournal(const char *fileName) {
+    #if defined(_WIN32)
+        FILE *file = fopen(fileName, "r+b");
+        if (file == NULL) {
+            file = fopen(fileName, "w+b");
+        }
+        if (file == NULL) {
+            printf("Error opening journal %s.\n", fileName);
+            return NULL;
+        }
+    #else
+        // Never truncate, another process may have just created the file
+        int fd = open(fileName, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            printf("Error opening journal %s.\n", fileName);
+            return NULL;
+        }
+
+        // One process owns the journal for as long as it runs, a second one would resume the same game
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            printf("Journal %s is used by another process.\n", fileName);
+            close(fd);
+            return NULL;
+        }
+        FILE *file = fdopen(fd, "r+b");
+        if (file == NULL) {
+            printf("Error opening journal %s.\n", fileName);
+            close(fd);
+            return NULL;
+        }
+    #endif
+
+    GameJournal *journal = (GameJournal*)calloc(1, sizeof(GameJournal));
+    journal->file = file;
+    journal->nextGameId = 1;
+
+    // Read every record, the first one that is torn or unknown ends the journal
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *bytes = (uint8_t*)malloc(size > 0 ? size : 1);
+    long valid = 0;
+    if (size > 0 && fread(bytes, 1, size, file) == (size_t)size) {
+        journal->records = (JournalRecord*)malloc((size / JOURNAL_RECORD_SIZE + 1) * sizeof(JournalRecord));
+        JournalRecord record;
+        bool isJournal = size >= JOURNAL_RECORD_SIZE && ReadJournalRecord(bytes, &record) &&
+                         record.type == JOURNAL_HEADER && record.gameId == JOURNAL_MAGIC && record.ply == JOURNAL_VERSION;
+        if (!isJournal) {
+            printf("Journal %s has an unknown format, delete it to start a new one.\n", fileName);
+            free(bytes);
+            free(journal->records);
+            free(journal);
+            fclose(file);
+            return NULL;
+        }
+        for (valid = JOURNAL_RECORD_SIZE; valid + JOURNAL_RECORD_SIZE <= size; valid += JOURNAL_RECORD_SIZE) {
+            if (!ReadJournalRecord(&bytes[valid], &record) || record.type == JOURNAL_HEADER) {
+                break;
+            }
+            journal->records[journal->recordCount++] = record;
+            if (record.gameId >= journal->nextGameId) {
+                journal->nextGameId = record.gameId + 1;
+            }
+        }
+    }
+    free(bytes);
+
+    if (valid == 0) {
+        JournalRecord header = {JOURNAL_HEADER, JOURNAL_VERSION, JOURNAL_MAGIC, 0, 0};
+        uint8_t out[JOURNAL_RECORD_SIZE];
+        WriteJournalRecord(&header, out);
+        if (fwrite(out, 1, JOURNAL_RECORD_SIZE, file) != JOURNAL_RECORD_SIZE || !SyncJournalFile(file)) {
+            printf("Error writing journal %s.\n", fileName);
+            free(journal->records);
+            free(journal);
+            fclose(file);
+            return NULL;
+        }
+        valid = JOURNAL_RECORD_SIZE;
+    } else if (valid < size) {
+        // The tail was being written when the process died, new records go after the last good one
+        printf("Journal %s: dropped %ld bytes of an incomplete write.\n", fileName, size - valid);
+        fflush(file);
+        #if defined(_WIN32)
+            _chsize(_fileno(file), valid);
+        #else
+            if (ftruncate(fileno(file), valid) != 0) {
+                printf("Error cutting journal %s.\n", fileName);
+            }
+        #endif
+    }
+    fseek(file, valid, SEEK_SET);
+
+    for (int i = 0; i < 2; i++) {
+        journal->capacities[i] = JOURNAL_BATCH_RECORDS * JOURNAL_RECORD_SIZE;
+        journal->buffers[i] = (uint8_t*)malloc(journal->capacities[i]);
+    }
+    pthread_mutex_init(&journal->lock, NULL);
+    pthread_cond_init(&journal->wake, NULL);
+    pthread_create(&journal->flusher, NULL, JournalFlusher, journal);
+    return journal;
+}
+
+void CloseJournal(GameJournal *journal) {
+    if (journal == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&journal->lock);
+    journal->isStopping = true;
+    pthread_cond_signal(&journal->wake);
+    pthread_mutex_unlock(&journal->lock);
+    pthread_join(journal->flusher, NULL);
+    if (journal->failed) {
+        fprintf(stderr, "The game journal is incomplete, a write failed.\n");
+    }
+
+    pthread_mutex_destroy(&journal->lock);
+    pthread_cond_destroy(&journal->wake);
+    fclose(journal->file);
+    free(journal->buffers[0]);
+    free(journal->buffers[1]);
+    free(journal->records);
+    free(journal);
+}
+
+void AppendJournal(GameJournal *journal, int type, uint32_t gameId, int ply, uint16_t move, int seconds) {
+    JournalRecord record = {(uint8_t)type, (uint16_t)ply, gameId, move, (uint16_t)max(0, min(seconds, 0xFFFF))};
+
+    pthread_mutex_lock(&journal->lock);
+    int active = journal->active;
+    if (journal->used + JOURNAL_RECORD_SIZE > journal->capacities[active]) {
+        // The disk is behind, grow the buffer rather than make the game wait
+        uint8_t *buffer = (uint8_t*)realloc(journal->buffers[active], journal->capacities[active] * 2);
+        if (buffer == NULL) {
+            FailJournal(journal);
+            pthread_mutex_unlock(&journal->lock);
+            return;
+        }
+        journal->buffers[active] = buffer;
+        journal->capacities[active] *= 2;
+    }
+    WriteJournalRecord(&record, &journal->buffers[active][journal->used]);
+    journal->used += JOURNAL_RECORD_SIZE;
+    journal->appended++;
+    if (journal->used == JOURNAL_RECORD_SIZE || journal->used >= JOURNAL_BATCH_RECORDS * JOURNAL_RECORD_SIZE) {
+        pthread_cond_signal(&journal->wake);
+    }
+    pthread_mutex_unlock(&journal->lock);
+}
+
+bool FindUnfinishedGame(const GameJournal *journal, uint32_t *gameId) {
+    for (int i = journal->recordCount - 1; i >= 0; i--) {
+        if (journal->records[i].type != JOURNAL_START) {
+            continue;
+        }
+        bool isFinished = false;
+        for (int j = i + 1; j < journal->recordCount && !isFinished; j++) {
+            isFinished = journal->records[j].type == JOURNAL_END && journal->records[j].gameId == journal->records[i].gameId;
+        }
+        if (!isFinished) {
+            *gameId = journal->records[i].gameId;
+            return true;
+        }
+    }
+    return false;
+}
+
+int RecoverGame(const GameJournal *journal, uint32_t gameId, Game *game) {
+    GameJournal *journalOfGame = game->journal;
+    int moves = 0;
+
+    game->journal = NULL; // The moves are in the journal already
+    for (int i = 0; i < journal->recordCount; i++) {
+        const JournalRecord *record = &journal->records[i];
+        if (record->gameId != gameId) {
+            continue;
+        }
+        if (record->type == JOURNAL_START) {
+            game->players[0]->timeLeft = record->seconds;
+            game->players[1]->timeLeft = record->seconds;
+        } else if (record->type == JOURNAL_MOVE) {
+            char input[6];
+            ConvertIndicesToAlgebraic((record->move & 63) / BOARD_SIZE, (record->move & 63) % BOARD_SIZE, input);
+            input[2] = '-';
+            ConvertIndicesToAlgebraic(((record->move >> 6) & 63) / BOARD_SIZE, ((record->move >> 6) & 63) % BOARD_SIZE, input + 3);
+            if (!PerformMove(game, input)) {
+                printf("Journal move %s of game %u does not fit the position, recovery stops there.\n", input, gameId);
+                break;
+            }
+
+            // The same clock update as UpdateTimeLeft, with the time the player took back then
+            Player *player = game->players[game->currentPlayer];
+            player->timeLeft -= record->seconds;
+            if (player->timeLeft <= 0) {
+                player->timeLeft = 0;
+                player->isLost = true;
+            }
+            SwitchPlayer(game);
+            moves++;
+        }
+    }
+    game->journal = journalOfGame;
+    return moves;
+}
+
+//##########################-----END OF JOURNAL FUNCTIONS---------############################
+
+
+
+//##########################-----PUZZLE SOLVER FUNCTIONS---------############################
+
+static ProofEntry* SolverProbe(MateSolver *solver, uint64_t key) {
+    return &solver->table[key & (SOLVER_TABLE_SIZE - 1)];
+}
+
+static void SolverLookup(MateSolver *solver, uint64_t key, uint32_t *pn, uint32_t *dn) {
+    ProofEntry *entry = SolverProbe(solver, key);
+    if (entry->key == key) {
+        *pn = entry->pn;
+        *dn = entry->dn;
+    } else {
+        *pn = 1; // Unknown nodes start as one step away from both results
+        *dn = 1;
+    }
+}
+
+static void SolverStore(MateSolver *solver, uint64_t key, uint32_t pn, uint32_t dn) {
+    ProofEntry *entry = SolverProbe(solver, key); // Always replace
+    entry->key = key;
+    entry->pn = pn;
+    entry->dn = dn;
+}
+
+static uint32_t AddProofNumbers(uint32_t a, uint32_t b) {
+    return (a + b >= PN_INFINITY) ? PN_INFINITY : a + b;
+}
+
+// Key of a node, the same position with a different number of moves left is a different node
+static uint64_t SolverKey(Board *board, char sideToMove, int movesLeft) {
+    return HashBoard(board, sideToMove) ^ zobristDepth[movesLeft];
+}
+
+// Depth-first proof-number search: expand the node until its proof number reaches thresholdPn
+// or its disproof number reaches thresholdDn, then leave the result in the table.
+// The attacker (OR node) needs one child proven, the defender (AND node) needs all of them.
+static void SolverSearch(MateSolver *solver, Board *board, char sideToMove, int movesLeft,
+                         uint64_t key, uint32_t thresholdPn, uint32_t thresholdDn) {
+    uint32_t pn, dn;
+    SolverLookup(solver, key, &pn, &dn);
+    if (pn >= thresholdPn || dn >= thresholdDn || pn == 0 || dn == 0) {
+        return;
+    }
+    solver->nodes++;
+
+    bool isAttacker = (sideToMove == solver->attacker);
+    if (isAttacker && movesLeft == 0) {
+        SolverStore(solver, key, PN_INFINITY, 0); // Out of moves without giving mate
+        return;
+    }
+
+    Move moves[MAX_LEGAL_MOVES];
+    int count = GenerateLegalMoves(board, sideToMove, moves);
+    if (count == 0) {
+        // Mate if the defender is in check, a stalemate or a mated attacker refutes the line
+        if (!isAttacker && IsKingInCheck(board, sideToMove)) {
+            SolverStore(solver, key, 0, PN_INFINITY);
+        } else {
+            SolverStore(solver, key, PN_INFINITY, 0);
+        }
+        return;
+    }
+    if (!isAttacker && movesLeft == 0) {
+        SolverStore(solver, key, PN_INFINITY, 0); // The defender can still move and no attacker move is left
+        return;
+    }
+
+    char nextSide = OpponentColor(sideToMove);
+    int nextMovesLeft = isAttacker ? movesLeft - 1 : movesLeft;
+    uint64_t childKeys[MAX_LEGAL_MOVES];
+    for (int i = 0; i < count; i++) {
+        MoveUndo undo;
+        MakeMove(board, &moves[i], &undo);
+        childKeys[i] = SolverKey(board, nextSide, nextMovesLeft);
+        UnmakeMove(board, &moves[i], &undo);
+    }
+
+    while (true) {
+        // Collect the numbers of the children and pick the most proving one
+        int best = 0;
+        uint32_t bestPn = 0, bestDn = 0;
+        uint32_t second = PN_INFINITY; // the runner up, it bounds how long we stay in the best child
+        uint32_t minimum = PN_INFINITY;
+        uint32_t sum = 0;
+
+        for (int i = 0; i < count; i++) {
+            uint32_t childPn, childDn;
+            SolverLookup(solver, childKeys[i], &childPn, &childDn);
+            uint32_t selector = isAttacker ? childPn : childDn;
+            uint32_t other = isAttacker ? childDn : childPn;
+            if (selector < minimum) {
+                second = minimum;
+                minimum = selector;
+                best = i;
+                bestPn = childPn;
+                bestDn = childDn;
+            } else if (selector < second) {
+                second = selector;
+            }
+            sum = AddProofNumbers(sum, other);
+        }
+
+        pn = isAttacker ? minimum : sum;
+        dn = isAttacker ? sum : minimum;
+        if (pn >= thresholdPn || dn >= thresholdDn || pn == 0 || dn == 0) {
+            break;
+        }
+
+        uint32_t childThresholdPn, childThresholdDn;
+        if (isAttacker) {
+            childThresholdPn = min(thresholdPn, AddProofNumbers(second, 1));
+            childThresholdDn = (thresholdDn >= PN_INFINITY) ? PN_INFINITY : thresholdDn - dn + bestDn;
+        } else {
+            childThresholdDn = min(thresholdDn, AddProofNumbers(second, 1));
+            childThresholdPn = (thresholdPn >= PN_INFINITY) ? PN_INFINITY : thresholdPn - pn + bestPn;
+        }
+
+        MoveUndo undo;
+        MakeMove(board, &moves[best], &undo);
+        SolverSearch(solver, board, nextSide, nextMovesLeft, childKeys[best], childThresholdPn, childThresholdDn);
+        UnmakeMove(board, &moves[best], &undo);
+    }
+
+    SolverStore(solver, key, pn, dn);
+}
+
+bool SolveMate(MateSolver *solver, Board *board, char sideToMove, int mateIn) {
+    uint32_t pn, dn;
+    uint64_t key = SolverKey(board, sideToMove, mateIn);
+
+    solver->attacker = sideToMove;
+    SolverSearch(solver, board, sideToMove, mateIn, key, PN_INFINITY, PN_INFINITY);
+    SolverLookup(solver, key, &pn, &dn);
+    return pn == 0;
+}
+
+// Follow the proven moves from the root and write them into the solution line.
+// A node the table lost is searched again, which is cheap next to the proof itself.
+static void SolverLine(MateSolver *solver, Board *board, char sideToMove, int movesLeft, char *line, size_t size) {
+    Move moves[MAX_LEGAL_MOVES];
+    int count = GenerateLegalMoves(board, sideToMove, moves);
+    bool isAttacker = (sideToMove == solver->attacker);
+    int nextMovesLeft = isAttacker ? movesLeft - 1 : movesLeft;
+    char nextSide = OpponentColor(sideToMove);
+
+    if (count == 0 || (isAttacker && movesLeft == 0)) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        MoveUndo undo;
+        MakeMove(board, &moves[i], &undo);
+
+        uint32_t pn, dn;
+        uint64_t key = SolverKey(board, nextSide, nextMovesLeft);
+        if (isAttacker) {
+            SolverSearch(solver, board, nextSide, nextMovesLeft, key, PN_INFINITY, PN_INFINITY);
+        }
+        SolverLookup(solver, key, &pn, &dn);
+
+        // The attacker plays a proven move, the defender any move (all of them lose)
+        if (!isAttacker || pn == 0) {
+            char text[8];
+            MoveToString(&moves[i], text);
+            if (strlen(line) + strlen(text) + 2 < size) {
+                strcat(line, (line[0] != '\0') ? " " : "");
+                strcat(line, text);
+            }
+            SolverLine(solver, board, nextSide, nextMovesLeft, line, size);
+            UnmakeMove(board, &moves[i], &undo);
+            return;
+        }
+        UnmakeMove(board, &moves[i], &undo);
+    }
+}
+
+void SolvePuzzle(Puzzle *puzzle, MateSolver *solver) {
+    Board board;
+    char sideToMove;
+
+    ClearBoard(&board);
+    puzzle->isValid = LoadFEN(&board, puzzle->fen, &sideToMove);
+    puzzle->isSearched = true;
+    puzzle->mateLength = 0;
+    puzzle->nodes = 0;
+    puzzle->solution[0] = '\0';
+
+    // A puzzle some other run has already solved only needs its solution line again
+    int firstDepth = 1;
+    PositionInfo info;
+    uint64_t key = puzzle->isValid ? HashBoard(&board, sideToMove) : 0;
+    if (puzzle->isValid && analysisCache != NULL && ProbeAnalysisCache(analysisCache, key, &info)) {
+        if (info.score > MATE_SCORE - 64 && MATE_SCORE - info.score <= puzzle->mateIn) {
+            firstDepth = MATE_SCORE - info.score;
+        } else if (info.score == 0 && info.depth >= puzzle->mateIn) {
+            firstDepth = puzzle->mateIn + 1; // Known to have no mate this short
+        }
+    }
+
+    if (puzzle->isValid) {
+        // Iterative deepening, so the reported mate is the shortest one
+        for (int n = firstDepth; n <= puzzle->mateIn && puzzle->mateLength == 0; n++) {
+            memset(solver->table, 0, SOLVER_TABLE_SIZE * sizeof(ProofEntry));
+            solver->nodes = 0;
+            if (SolveMate(solver, &board, sideToMove, n)) {
+                puzzle->mateLength = n;
+                SolverLine(solver, &board, sideToMove, n, puzzle->solution, sizeof(puzzle->solution));
+            }
+            puzzle->nodes += solver->nodes;
+        }
+    }
+
+    if (puzzle->isValid && analysisCache != NULL) {
+        AnalysePosition(&board, sideToMove, &info);
+        info.hasBestMove = puzzle->mateLength > 0;
+        if (info.hasBestMove) {
+            ConvertAlgebraicToIndices(&puzzle->solution[0], &info.bestStartX, &info.bestStartY);
+            ConvertAlgebraicToIndices(&puzzle->solution[3], &info.bestEndX, &info.bestEndY);
+        }
+        info.score = (puzzle->mateLength > 0) ? MATE_SCORE - puzzle->mateLength : 0;
+        info.depth = (puzzle->mateLength > 0) ? puzzle->mateLength : puzzle->mateIn;
+        StoreAnalysisCache(analysisCache, key, &info);
+    }
+
+    FreeBoard(&board);
+}
+
+typedef struct // struct shared by the solver threads of a batch
+{
+    Puzzle *puzzles;
+    int count;
+    int next;              // the next puzzle nobody has taken yet
+    pthread_mutex_t lock;
+} PuzzleBatch;
+
+static void* PuzzleWorker(void *argument) {
+    PuzzleBatch *batch = (PuzzleBatch*)argument;
+    MateSolver solver;
+
+    // Without a table this thread takes no puzzles, the others solve them
+    solver.table = (ProofEntry*)malloc(SOLVER_TABLE_SIZE * sizeof(ProofEntry));
+    if (solver.table == NULL) {
+        return NULL;
+    }
+
+    while (true) {
+        pthread_mutex_lock(&batch->lock);
+        int index = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+
+        if (index >= batch->count) {
+            break;
+        }
+        SolvePuzzle(&batch->puzzles[index], &solver);
+    }
+
+    free(solver.table);
+    return NULL;
+}
+
+int RunPuzzleSolver(const char *fileName, int threadCount) {
+    FILE *file = fopen(fileName, "r");
+    if (file == NULL) {
+        printf("Error opening puzzle file %s.\n", fileName);
+        return 1;
+    }
+
+    // Read every puzzle first, the threads take them one by one
+    PuzzleBatch batch = {0};
+    int capacity = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *separator = strchr(line, ';');
+        if (line[0] == '#' || separator == NULL) {
+            continue; // Comments and lines without a move count
+        }
+        if (batch.count == capacity) {
+            Puzzle *puzzles = (Puzzle*)realloc(batch.puzzles, (capacity == 0 ? 64 : capacity * 2) * sizeof(Puzzle));
+            if (puzzles == NULL) {
+                printf("Not enough memory for more than %d puzzles.\n", batch.count);
+                break;
+            }
+            batch.puzzles = puzzles;
+            capacity = (capacity == 0) ? 64 : capacity * 2;
+        }
+        Puzzle *puzzle = &batch.puzzles[batch.count++];
+        memset(puzzle, 0, sizeof(Puzzle));
+        *separator = '\0';
+        snprintf(puzzle->fen, sizeof(puzzle->fen), "%.127s", line);
+        puzzle->mateIn = max(1, min(atoi(separator + 1), 31));
+    }
+    fclose(file);
+
+    threadCount = max(1, min(threadCount, max(batch.count, 1)));
+    pthread_mutex_init(&batch.lock, NULL);
+
+    time_t startTime = time(NULL);
+    pthread_t *threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+    if (threads == NULL) {
+        PuzzleWorker(&batch); // Solve them on this thread
+        threadCount = 1;
+    }
+    for (int i = 0; threads != NULL && i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, PuzzleWorker, &batch);
+    }
+    for (int i = 0; threads != NULL && i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&batch.lock);
+
+    // Print the results in the order of the file
+    unsigned long long totalNodes = 0;
+    int solved = 0;
+    for (int i = 0; i < batch.count; i++) {
+        Puzzle *puzzle = &batch.puzzles[i];
+        totalNodes += puzzle->nodes;
+        if (!puzzle->isSearched) {
+            printf("Puzzle %d: not solved (out of memory)\n", i + 1);
+        } else if (!puzzle->isValid) {
+            printf("Puzzle %d: invalid FEN \"%s\"\n", i + 1, puzzle->fen);
+        } else if (puzzle->mateLength > 0) {
+            solved++;
+            printf("Puzzle %d: mate in %d (%llu nodes): %s\n", i + 1, puzzle->mateLength, puzzle->nodes, puzzle->solution);
+        } else {
+            printf("Puzzle %d: no forced mate in %d (%llu nodes)\n", i + 1, puzzle->mateIn, puzzle->nodes);
+        }
+    }
+    printf("\nSolved %d of %d puzzles, %llu nodes, %d threads, %.0f seconds\n",
+           solved, batch.count, totalNodes, threadCount, difftime(time(NULL), startTime));
+
+    free(batch.puzzles);
+    return 0;
+}
 
+//##########################-----END OF PUZZLE SOLVER FUNCTIONS---------############################